@@ -135,6 +135,35 @@ class Adafruit_RA8875_R : public Adafruit_RA8875 {
 	    Adafruit_RA8875::fillTriangle(x0, y0, x1, y1, x2, y2, color);
 	}
 
+	// convex polygon of at most 16 vertices; ESP has no native polygon so fan it into triangles
+	void fillPolygon(const int16_t x[], const int16_t y[], int n, uint16_t color)
+	{
+	    int16_t rx[16], ry[16];
+	    if (n < 3 || n > 16)
+		return;
+	    for (int i = 0; i < n; i++) {
+		rx[i] = rotation == 2 ? width()  - 1 - x[i] : x[i];
+		ry[i] = rotation == 2 ? height() - 1 - y[i] : y[i];
+	    }
+#if defined (_USE_DESKTOP)
+	    Adafruit_RA8875::fillPolygon(rx, ry, n, color);
+#else
+	    for (int i = 1; i < n-1; i++)
+		Adafruit_RA8875::fillTriangle(rx[0], ry[0], rx[i], ry[i], rx[i+1], ry[i+1], color);
+#endif
+	}
+
+#if defined (_USE_DESKTOP)
+	void eraseOverlay (int16_t x, int16_t y, int16_t w, int16_t h)
+	{
+	    if (rotation == 2) {
+		x = width()  - x - w;
+		y = height() - y - h;
+	    }
+	    Adafruit_RA8875::eraseOverlay (x, y, w, h);
+	}
+#endif
+
 #if !defined (_USE_DESKTOP)
         // stubs for ESP Arduino
         void setPR (uint16_t x, uint16_t y, uint16_t w, uint16_t h) {
@@ -145,6 +174,9 @@ class Adafruit_RA8875_R : public Adafruit_RA8875 {
             (void)(h);
         }
         void drawPR(void) {}
+        void getPRTimes (uint32_t &stage_us, uint32_t &show_us) {
+            stage_us = show_us = 0;
+        }
         void blankScreen (bool yes) {
             // avoid "used" warning
             (void)(yes);
@@ -152,6 +184,10 @@ class Adafruit_RA8875_R : public Adafruit_RA8875 {
         char getChar(void) {
             return (0);
         }
+        void beginBatch(void) {}
+        void endBatch(void) {}
+        void beginOverlay(void) {}
+        void endOverlay(void) {}
 #endif
 
 };
@@ -10,7 +10,11 @@
  *   uses one supporting thread to manage the X11 display connection and input.
  *
  * Both systems use a memory array named fb_canvas as a pixel-by-pixel rendering surface. This is
- * periodically copied to fb_stage on change. _USE_FB0 uses a third copy fb_cursor in which to draw cursor.
+ * periodically copied to fb_stage on change. _USE_FB0 draws the cursor as a sprite directly on the hardware,
+ * restoring the pixels beneath it from fb_stage.
+ * Each drawing method marks the tiles of fb_canvas it touches in fb_dtiles so only those regions are
+ * staged and sent on to the display. Map symbols may instead be drawn into fb_over, which is laid over
+ * fb_canvas as it is staged so they can be moved or erased without redrawing the map beneath.
  * FB_X0 and FB_Y0 are the upper left coords on the hardware of drawing area FB_YRES x FB_XRES.
  * 
  * This class assumes the original ESP Arduino code was drawing onto a canvas 800w x 480h, set by APP_WIDTH
@@ -33,9 +37,26 @@
 #include <sys/time.h>
 #include <sys/types.h>
 #include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <poll.h>
+
+// N.B. bench/ defines _FILL_NEON with its own arm_neon.h to check the NEON kernels on any host
+#if defined(_FILL_NEON)
+#include <arm_neon.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#define _FILL_X86
+#include <immintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define _FILL_NEON
+#include <arm_neon.h>
+#endif
 
 #include "Adafruit_RA8875.h"
 
+static Adafruit_RA8875::FillSpanFunc chooseFillSpan (const char **name);
+static Adafruit_RA8875::EarthSpanFunc chooseEarthSpan (const char **name);
+
 uint32_t spi_speed;
 
 Adafruit_RA8875::Adafruit_RA8875(uint8_t CS, uint8_t RST)
@@ -45,6 +66,40 @@ Adafruit_RA8875::Adafruit_RA8875(uint8_t CS, uint8_t RST)
 
         // init the protected region flag
         pr_flag = 0;
+        pr_seq = pr_shown = 0;
+        fb_stage_us = fb_show_us = pr_stage_us = pr_show_us = 0;
+
+        // no render thread to wake yet
+        fb_wake[0] = fb_wake[1] = -1;
+
+        // no batch yet
+        fb_batch = 0;
+
+        // no overlay until begin()
+        fb_over = NULL;
+        fb_over_depth = 0;
+        memset (fb_otiles, 0, sizeof(fb_otiles));
+
+        // pick the fastest span fill for this cpu
+        fill_span = chooseFillSpan (&fill_span_name);
+        earth_span = chooseEarthSpan (&earth_span_name);
+
+        // no earth maps until begin(), no sun yet, see setEarthSun()
+        memset (fb_mip, 0, sizeof(fb_mip));
+        fb_nmips = 0;
+        memset (fb_sun, 0, sizeof(fb_sun));
+        fb_sun_lat = fb_sun_lng = 0;
+        fb_sun_motion = 0;
+
+        // no map layer until asked for
+        fb_map = NULL;
+        fb_map_exp = NULL;
+        memset (fb_mtiles, 0, sizeof(fb_mtiles));
+
+        // no glyphs cached yet
+        memset (fb_gfonts, 0, sizeof(fb_gfonts));
+        fb_ngfonts = 0;
+        fb_gfont = NULL;
 }
 
 bool Adafruit_RA8875::begin (int x)
@@ -86,17 +141,26 @@ bool Adafruit_RA8875::begin (int x)
 	    exit(1);
 	}
 	memset (fb_canvas, 0, fb_nbytes);
+	initOverlay();
+	initEarthMaps();
 
-	// get memory for the staging area used to find dirty pixels
-	fb_stage = (uint32_t *) malloc (fb_nbytes);
-	if (!fb_stage) {
-	    printf ("Can not malloc(%d) for stage\n", fb_nbytes);
-	    exit(1);
+	// get shared memory for the staging area and its XImage if possible, else use plain memory
+	use_shm = initShm (visual);
+	if (use_shm) {
+	    printf ("X11: using MIT-SHM\n");
+	} else {
+	    fb_stage = (uint32_t *) malloc (fb_nbytes);
+	    if (!fb_stage) {
+		printf ("Can not malloc(%d) for stage\n", fb_nbytes);
+		exit(1);
+	    }
+	    img = XCreateImage(display,visual,24,ZPixmap,0,(char*)fb_stage,FB_XRES,FB_YRES,32,0);
 	}
 	memset (fb_stage, 0, fb_nbytes);
 
-	// create XImage using staging area
-	img = XCreateImage(display,visual,24,ZPixmap,0,(char*)fb_stage,FB_XRES,FB_YRES,32,0);
+	// nothing is dirty yet
+	memset (fb_dtiles, 0, sizeof(fb_dtiles));
+	fb_nsrects = 0;
 
 	// create window with initial size, user might resize later
 	XSetWindowAttributes wa;
@@ -159,10 +223,14 @@ bool Adafruit_RA8875::begin (int x)
 	    printf ("fb_lock: %s\n", strerror(errno));
 	    exit(1);
 	}
+	initWake();
 
 	// start with default font
 	current_font = &Courier_Prime_Sans6pt7b;
 
+	printf ("Fill kernel: %s\n", fill_span_name);
+	printf ("Earth kernel: %s\n", earth_span_name);
+
 	// start X11 thread
 	pthread_t tid;
 	int e = pthread_create (&tid, NULL, fbThreadHelper, this);
@@ -245,9 +313,12 @@ bool Adafruit_RA8875::begin (int x)
 	mouse_x = FB_X0;
 	mouse_y = FB_Y0;
 
+	// see whether we can flip between two pages, this may change fb_si.yres_virtual
+        initFlip();
+
 	// map fb to our address space
         fb_pixlen = sizeof(*fb_fb);
-        size_t si_bytes = fb_pixlen * fb_si.xres * fb_si.yres;
+        size_t si_bytes = fb_pixlen * fb_si.xres * fb_si.yres * (fb_flip ? 2 : 1);
         fb_fb = (uint32_t*) mmap(NULL, si_bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fb_fd, 0);
 	if (!fb_fb) {
 	    printf ("mmap(%u): %s\n", si_bytes, strerror(errno));
@@ -255,7 +326,7 @@ bool Adafruit_RA8875::begin (int x)
 	    exit(1);
 	}
 
-	// initial clear
+	// initial clear, this is the only time the borders are drawn
 	memset (fb_fb, 0, si_bytes);
 
 	// make backing buffers
@@ -267,13 +338,21 @@ bool Adafruit_RA8875::begin (int x)
 	    exit(1);
 	}
 	memset (fb_canvas, 0, fb_nbytes);
+	initOverlay();
+	initEarthMaps();
 	fb_stage = (uint32_t *) malloc (fb_nbytes);
-	fb_cursor = (uint32_t *) malloc (fb_nbytes);
-	if (!fb_stage || !fb_cursor) {
-	    printf ("Can not malloc(%d) for stage or cursor\n", fb_nbytes);
+	if (!fb_stage) {
+	    printf ("Can not malloc(%d) for stage\n", fb_nbytes);
 	    close(fb_fd);
 	    exit(1);
 	}
+	memset (fb_stage, 0, fb_nbytes);
+	initCursor();
+
+	// nothing is dirty yet
+	memset (fb_dtiles, 0, sizeof(fb_dtiles));
+	fb_nsrects = 0;
+	fb_nprects = 0;
 
 	// set up a reentrantable lock
 	pthread_mutexattr_t fb_attr;
@@ -284,10 +363,14 @@ bool Adafruit_RA8875::begin (int x)
 	    close(fb_fd);
 	    exit(1);
 	}
+	initWake();
 
 	// start with default font
 	current_font = &Courier_Prime_Sans6pt7b;
 
+	printf ("Fill kernel: %s\n", fill_span_name);
+	printf ("Earth kernel: %s\n", earth_span_name);
+
 	// start fb thread
 	e = pthread_create (&tid, NULL, fbThreadHelper, this);
 	if (e) {
@@ -360,16 +443,12 @@ void Adafruit_RA8875::print (char c)
 
 void Adafruit_RA8875::print (char *s)
 {
-	char c;
-	while ((c = *s++) != '\0')
-	    plotChar (c);
+	plotString (s, strlen(s));
 }
 
 void Adafruit_RA8875::print (const char *s)
 {
-	char c;
-	while ((c = *s++) != '\0')
-	    plotChar (c);
+	plotString (s, strlen(s));
 }
 
 void Adafruit_RA8875::print (int i, int b)
@@ -377,24 +456,21 @@ void Adafruit_RA8875::print (int i, int b)
 	char buf[32];
         const char *fmt = (b == 16 ? "%x" : "%d");
 	int sl = snprintf (buf, sizeof(buf), fmt, i);
-	for (int i = 0; i < sl; i++)
-	    plotChar (buf[i]);
+	plotString (buf, sl);
 }
 
 void Adafruit_RA8875::print (float f, int p)
 {
 	char buf[32];
 	int sl = snprintf (buf, sizeof(buf), "%.*f", p, f);
-	for (int i = 0; i < sl; i++)
-	    plotChar (buf[i]);
+	plotString (buf, sl);
 }
 
 void Adafruit_RA8875::print (long l)
 {
 	char buf[32];
 	int sl = snprintf (buf, sizeof(buf), "%lu", l);
-	for (int i = 0; i < sl; i++)
-	    plotChar (buf[i]);
+	plotString (buf, sl);
 }
 
 void Adafruit_RA8875::println (void)
@@ -616,7 +692,7 @@ void Adafruit_RA8875::drawPixel(int16_t x, int16_t y, uint16_t color16)
 	uint32_t c32 = RGB1632(color16);
 	x *= SCALESZ;
 	y *= SCALESZ;
-	pthread_mutex_lock(&fb_lock);
+	lockFB();
 	    if (SCALESZ == 2) {
 		plot32 (x, y, c32);
 		plot32 (x, y+1, c32);
@@ -627,8 +703,8 @@ void Adafruit_RA8875::drawPixel(int16_t x, int16_t y, uint16_t color16)
 		    for (uint8_t dy = 0; dy < SCALESZ; dy++)
 			plot32 (x+dx, y+dy, c32);
 	    }
-	    fb_dirty = true;
-	pthread_mutex_unlock (&fb_lock);
+	    markDirty (x, y, x+SCALESZ-1, y+SCALESZ-1);
+	unlockFB();
 }
 
 void Adafruit_RA8875::drawPixels (uint16_t * p, uint32_t count, int16_t x, int16_t y)
@@ -642,10 +718,10 @@ void Adafruit_RA8875::drawPixels (uint16_t * p, uint32_t count, int16_t x, int16
 void Adafruit_RA8875::drawSubPixel(int16_t x, int16_t y, uint16_t color16)
 {
 	uint32_t c32 = RGB1632(color16);
-	pthread_mutex_lock(&fb_lock);
+	lockFB();
 	    plot32 (x, y, c32);
-	    fb_dirty = true;
-	pthread_mutex_unlock (&fb_lock);
+	    markDirty (x, y, x, y);
+	unlockFB();
 }
 
 void Adafruit_RA8875::drawLine(int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint16_t color16)
@@ -655,10 +731,10 @@ void Adafruit_RA8875::drawLine(int16_t x0, int16_t y0, int16_t x1, int16_t y1, u
 	y0 *= SCALESZ;
 	x1 *= SCALESZ;
 	y1 *= SCALESZ;
-	pthread_mutex_lock(&fb_lock);
+	lockFB();
 	    plotLine (x0, y0, x1, y1, c32);
-	    fb_dirty = true;
-	pthread_mutex_unlock (&fb_lock);
+	    markDirty (x0, y0, x1, y1);
+	unlockFB();
 }
 
 /* Adafruit's drawRect of width w draws from x0 through x0+w-1, ie, it draws w pixels wide and skips w-2
@@ -676,13 +752,13 @@ void Adafruit_RA8875::drawRect(int16_t x0, int16_t y0, int16_t w, int16_t h, uin
         h -= 1;
 	w *= SCALESZ;
 	h *= SCALESZ;
-	pthread_mutex_lock (&fb_lock);
+	lockFB();
 	    plotLine (x0, y0, x0+w, y0, c32);
 	    plotLine (x0+w, y0, x0+w, y0+h, c32);
 	    plotLine (x0+w, y0+h, x0, y0+h, c32);
 	    plotLine (x0, y0+h, x0, y0, c32);
-	    fb_dirty = true;
-	pthread_mutex_unlock (&fb_lock);
+	    markDirty (x0, y0, x0+w, y0+h);
+	unlockFB();
 }
 
 /* Adafruit's fillRect of width w draws from x0 through x0+w-1, ie, it draws w pixels wide
@@ -698,12 +774,11 @@ void Adafruit_RA8875::fillRect(int16_t x0, int16_t y0, int16_t w, int16_t h, uin
 	    h = 1;
 	w *= SCALESZ;
 	h *= SCALESZ;
-	pthread_mutex_lock (&fb_lock);
-	    for (uint16_t y = y0; y < y0+h; y++)
-		for (uint16_t x = x0; x < x0+w; x++)
-		    plot32 (x, y, c32);
-	    fb_dirty = true;
-	pthread_mutex_unlock (&fb_lock);
+	lockFB();
+	    for (int y = y0; y < y0+h; y++)
+		fillSpan (x0, y, w, c32);
+	    markDirty (x0, y0, x0+w-1, y0+h-1);
+	unlockFB();
 }
 
 /* Adafruit's circle radius is counts beyond center, eg, radius 3 is 7 pixels wide
@@ -715,20 +790,25 @@ void Adafruit_RA8875::drawCircle(int16_t x0, int16_t y0, int16_t r0, uint16_t co
 	y0 *= SCALESZ;
 	r0 *= SCALESZ;
 
-        // scan a circle from radius r0-1/2 to r0+1/2 to include a whole pixel.
-        // radius (r0+1/2)^2 = r0^2 + r0 + 1/4 so we use 2x everywhere to avoid floats
-        uint32_t iradius2 = 4*r0*(r0 - 1) + 1;
-        uint32_t oradius2 = 4*r0*(r0 + 1) + 1;
-	pthread_mutex_lock (&fb_lock);
-	    for (int32_t dy = -2*r0; dy <= 2*r0; dy += 2) {
-                for (int32_t dx = -2*r0; dx <= 2*r0; dx += 2) {
-                    uint32_t xy2 = dx*dx + dy*dy;
-                    if (xy2 >= iradius2 && xy2 <= oradius2)
-			plot32 (x0+dx/2, y0+dy/2, c32);
-                }
+        // draw a ring from radius r0-1/2 to r0+1/2 to include a whole pixel.
+        // radius (r0+1/2)^2 = r0^2 + r0 + 1/4 so we use 2x everywhere to avoid floats.
+        // walk down from the center row tracking the outer and inner half-widths of the ring, each of
+        // which can only shrink, and fill the spans between them on the rows above and below.
+        int32_t iradius2 = 4*r0*(r0 - 1) + 1;
+        int32_t oradius2 = 4*r0*(r0 + 1) + 1;
+        int ho = r0, hi = r0;
+	lockFB();
+	    for (int dy = 0; dy <= r0; dy++) {
+                while (4*(ho*ho + dy*dy) > oradius2)
+                    ho--;
+                while (hi >= 0 && 4*(hi*hi + dy*dy) >= iradius2)
+                    hi--;
+                fillRingRow (x0, y0+dy, ho, hi, c32);
+                if (dy > 0)
+                    fillRingRow (x0, y0-dy, ho, hi, c32);
             }
-	    fb_dirty = true;
-	pthread_mutex_unlock (&fb_lock);
+	    markDirty (x0-r0, y0-r0, x0+r0, y0+r0);
+	unlockFB();
 
 }
 
@@ -741,19 +821,21 @@ void Adafruit_RA8875::fillCircle(int16_t x0, int16_t y0, int16_t r0, uint16_t co
 	y0 *= SCALESZ;
 	r0 *= SCALESZ;
 
-        // scan a circle of radius r0+1/2 to include whole pixel.
-        // radius (r0+1/2)^2 = r0^2 + r0 + 1/4 so we use 2x everywhere to avoid floats
-        uint32_t radius2 = 4*r0*(r0 + 1) + 1;
-	pthread_mutex_lock (&fb_lock);
-	    for (int32_t dy = -2*r0; dy <= 2*r0; dy += 2) {
-                for (int32_t dx = -2*r0; dx <= 2*r0; dx += 2) {
-                    uint32_t xy2 = dx*dx + dy*dy;
-                    if (xy2 <= radius2)
-			plot32 (x0+dx/2, y0+dy/2, c32);
-                }
+        // fill a circle of radius r0+1/2 to include whole pixel.
+        // radius (r0+1/2)^2 = r0^2 + r0 + 1/4 so we use 2x everywhere to avoid floats.
+        // walk down from the center row shrinking the half-width as needed and fill the rows above and below.
+        int32_t radius2 = 4*r0*(r0 + 1) + 1;
+        int hw = r0;
+	lockFB();
+	    for (int dy = 0; dy <= r0; dy++) {
+                while (4*(hw*hw + dy*dy) > radius2)
+                    hw--;
+                fillSpan (x0-hw, y0+dy, 2*hw+1, c32);
+                if (dy > 0)
+                    fillSpan (x0-hw, y0-dy, 2*hw+1, c32);
             }
-	    fb_dirty = true;
-	pthread_mutex_unlock (&fb_lock);
+	    markDirty (x0-r0, y0-r0, x0+r0, y0+r0);
+	unlockFB();
 }
 
 void Adafruit_RA8875::drawTriangle(int16_t x0, int16_t y0, int16_t x1, int16_t y1, int16_t x2, int16_t y2,
@@ -766,39 +848,538 @@ void Adafruit_RA8875::drawTriangle(int16_t x0, int16_t y0, int16_t x1, int16_t y
 	y1 *= SCALESZ;
 	x2 *= SCALESZ;
 	y2 *= SCALESZ;
-	pthread_mutex_lock (&fb_lock);
+	lockFB();
 	    plotLine (x0, y0, x1, y1, c32);
 	    plotLine (x1, y1, x2, y2, c32);
 	    plotLine (x2, y2, x0, y0, c32);
-	    fb_dirty = true;
-	pthread_mutex_unlock (&fb_lock);
+	    // edge 2-0 can cross tiles outside the boxes of the others so mark the box of all three
+	    int16_t minx = x0 < x1 ? (x0 < x2 ? x0 : x2) : (x1 < x2 ? x1 : x2);
+	    int16_t maxx = x0 > x1 ? (x0 > x2 ? x0 : x2) : (x1 > x2 ? x1 : x2);
+	    int16_t miny = y0 < y1 ? (y0 < y2 ? y0 : y2) : (y1 < y2 ? y1 : y2);
+	    int16_t maxy = y0 > y1 ? (y0 > y2 ? y0 : y2) : (y1 > y2 ? y1 : y2);
+	    markDirty (minx, miny, maxx, maxy);
+	unlockFB();
 }
 
+/* fill the triangle with the given vertices, any shape and winding, in app coords.
+ * vertices land on the fb pixels at x*SCALESZ, y*SCALESZ and every fb pixel on or inside the edges is
+ * filled, including the bottom row and right column, the same as the real RA8875.
+ */
 void Adafruit_RA8875::fillTriangle(int16_t x0, int16_t y0, int16_t x1, int16_t y1, int16_t x2, int16_t y2,
     uint16_t color16)
 {
+	// fb vertices sorted top to bottom
+	int32_t X[3] = {x0*SCALESZ, x1*SCALESZ, x2*SCALESZ};
+	int32_t Y[3] = {y0*SCALESZ, y1*SCALESZ, y2*SCALESZ};
+	for (int i = 0; i < 2; i++) {
+	    for (int j = 0; j < 2-i; j++) {
+		if (Y[j] > Y[j+1]) {
+		    int32_t t;
+		    t = X[j]; X[j] = X[j+1]; X[j+1] = t;
+		    t = Y[j]; Y[j] = Y[j+1]; Y[j+1] = t;
+		}
+	    }
+	}
+	int32_t minx = X[0], maxx = X[0];
+	for (int i = 1; i < 3; i++) {
+	    if (X[i] < minx) minx = X[i];
+	    if (X[i] > maxx) maxx = X[i];
+	}
+	int ytop = Y[0] < 0 ? 0 : Y[0];
+	int ybot = Y[2] >= FB_YRES ? FB_YRES-1 : Y[2];
+
 	uint32_t c32 = RGB1632(color16);
-	x0 *= SCALESZ;
-	y0 *= SCALESZ;
-	x1 *= SCALESZ;
-	y1 *= SCALESZ;
-	x2 *= SCALESZ;
-	y2 *= SCALESZ;
+	lockFB();
+	    if (Y[0] == Y[2]) {
+		// all on one row
+		if (ytop == Y[0] && ybot == Y[0])
+		    fillSpan (minx, Y[0], maxx - minx + 1, c32);
+	    } else {
+		// each row runs between the long edge 0-2 and edge 0-1 above vertex 1 or 1-2 below it
+		for (int py = ytop; py <= ybot; py++) {
+		    int xl, xr;
+		    polyRun (X[0], Y[0], X[2], Y[2], py, xl, xr);
+		    int sl, sr;
+		    if (py < Y[1])
+			polyRun (X[0], Y[0], X[1], Y[1], py, sl, sr);
+		    else if (py > Y[1])
+			polyRun (X[1], Y[1], X[2], Y[2], py, sl, sr);
+		    else
+			sl = sr = X[1];
+		    if (sl < xl) xl = sl;
+		    if (sr > xr) xr = sr;
+		    if (xl <= xr)
+			fillSpan (xl, py, xr - xl + 1, c32);
+		}
+	    }
+	    markDirty (minx, Y[0], maxx, Y[2]);
+	unlockFB();
+}
+
+/* find the fb pixels on edge xa,ya .. xb,yb, ya < yb, in row ya <= py <= yb:
+ * xl is the first at or right of the edge and xr the last at or left of it, so xl > xr unless the edge
+ * passes exactly through a pixel.
+ */
+void Adafruit_RA8875::polyRun (int32_t xa, int32_t ya, int32_t xb, int32_t yb, int py, int &xl, int &xr)
+{
+	int64_t dy = yb - ya;
+	int64_t xnum = (int64_t)xa*dy + (int64_t)(py - ya)*(xb - xa);
+	int64_t q = xnum / dy;
+	int64_t r = xnum - q*dy;
+	xl = (int)(r > 0 ? q+1 : q);
+	xr = (int)(r < 0 ? q-1 : q);
+}
 
-	// THIS ONLY WORKS FOR EQUALATORAL POINTED UP WITH x0/y0 top, x1/y1 left x2/y2 right.
-	// google for raster triangle, eg
-	//     http://www.gabrielgambetta.com/computer-graphics-from-scratch/filled-triangles.html
-	// TODO
-	int dy = y1 - y0;
-	int dx = x2 - x0;
-	pthread_mutex_lock (&fb_lock);
-	    for (int y = y0; y <= y1; y++) {
-		int xleft = x0 - dx*(y-y0)/dy;
-		int xrite = x0 + dx*(y-y0)/dy;
-		plotLine (xleft, y, xrite, y, c32);
+/* fill the polygon with the given n vertices, any winding, in app coords.
+ * vertices land on the fb pixels at x*SCALESZ, y*SCALESZ as in fillTriangle() but the top-left
+ * convention applies to every edge, by the even-odd rule: pixels exactly on a bottom or right edge
+ * are left for the neighbour, so polygons sharing an edge never overlap or leave a gap. intended
+ * for convex shapes but any simple polygon of at most FB_MAX_POLY vertices works.
+ */
+void Adafruit_RA8875::fillPolygon (const int16_t x[], const int16_t y[], int n, uint16_t color16)
+{
+	if (n < 3 || n > FB_MAX_POLY)
+	    return;
+
+	int32_t X[FB_MAX_POLY], Y[FB_MAX_POLY];
+	int32_t minx = 0, maxx = 0, miny = 0, maxy = 0;
+	for (int i = 0; i < n; i++) {
+	    X[i] = x[i]*SCALESZ;
+	    Y[i] = y[i]*SCALESZ;
+	    if (i == 0 || X[i] < minx) minx = X[i];
+	    if (i == 0 || X[i] > maxx) maxx = X[i];
+	    if (i == 0 || Y[i] < miny) miny = Y[i];
+	    if (i == 0 || Y[i] > maxy) maxy = Y[i];
+	}
+
+	// rows in [miny, maxy)
+	int ytop = miny < 0 ? 0 : miny;
+	int ybot = maxy > FB_YRES ? FB_YRES : maxy;
+
+	uint32_t c32 = RGB1632(color16);
+	lockFB();
+	    for (int py = ytop; py < ybot; py++) {
+		int xs[FB_MAX_POLY];
+		int nxs = 0;
+		for (int i = 0, j = n-1; i < n; j = i++) {
+		    // edge j..i oriented downward, covers row if its top <= py < its bottom
+		    int32_t xa = X[j], ya = Y[j], xb = X[i], yb = Y[i];
+		    if (ya > yb) {
+			int32_t t;
+			t = xa; xa = xb; xb = t;
+			t = ya; ya = yb; yb = t;
+		    }
+		    if (py < ya || py >= yb)
+			continue;
+		    int64_t dy = yb - ya;
+		    int64_t xnum = (int64_t)xa*dy + (int64_t)(py - ya)*(xb - xa);
+		    // insertion sort, n is small
+		    int px = polyCeil (xnum, dy);
+		    int k = nxs++;
+		    while (k > 0 && xs[k-1] > px) {
+			xs[k] = xs[k-1];
+			k--;
+		    }
+		    xs[k] = px;
+		}
+		for (int k = 0; k+1 < nxs; k += 2)
+		    fillSpan (xs[k], py, xs[k+1] - xs[k], c32);
 	    }
-	    fb_dirty = true;
-	pthread_mutex_unlock (&fb_lock);
+	    markDirty (minx, miny, maxx - 1, maxy - 1);
+	unlockFB();
+}
+
+/* return ceil(num/den), den > 0.
+ */
+int Adafruit_RA8875::polyCeil (int64_t num, int64_t den)
+{
+	int64_t q = num / den;
+	if (q*den < num)
+	    q++;
+	return ((int)q);
+}
+
+/********************************************************************************************************
+ *
+ * span fill kernels, chosen once at runtime according to cpu capabilities
+ *
+ */
+
+/* fill n pixels starting at dst with color32, one at a time.
+ */
+static void fillSpanScalar (uint32_t *dst, uint32_t color32, int n)
+{
+        while (n-- > 0)
+            *dst++ = color32;
+}
+
+#if defined(_FILL_X86)
+
+/* fill n pixels starting at dst with color32, 4 at a time using SSE2.
+ */
+__attribute__((target("sse2")))
+static void fillSpanSSE2 (uint32_t *dst, uint32_t color32, int n)
+{
+        while (n > 0 && ((uintptr_t)dst & 15)) {
+            *dst++ = color32;
+            n--;
+        }
+        __m128i v = _mm_set1_epi32 (color32);
+        for (; n >= 8; n -= 8, dst += 8) {
+            _mm_store_si128 ((__m128i *)dst, v);
+            _mm_store_si128 ((__m128i *)(dst+4), v);
+        }
+        for (; n >= 4; n -= 4, dst += 4)
+            _mm_store_si128 ((__m128i *)dst, v);
+        while (n-- > 0)
+            *dst++ = color32;
+}
+
+/* fill n pixels starting at dst with color32, 8 at a time using AVX2.
+ */
+__attribute__((target("avx2")))
+static void fillSpanAVX2 (uint32_t *dst, uint32_t color32, int n)
+{
+        while (n > 0 && ((uintptr_t)dst & 31)) {
+            *dst++ = color32;
+            n--;
+        }
+        __m256i v = _mm256_set1_epi32 (color32);
+        for (; n >= 16; n -= 16, dst += 16) {
+            _mm256_store_si256 ((__m256i *)dst, v);
+            _mm256_store_si256 ((__m256i *)(dst+8), v);
+        }
+        for (; n >= 8; n -= 8, dst += 8)
+            _mm256_store_si256 ((__m256i *)dst, v);
+        while (n-- > 0)
+            *dst++ = color32;
+}
+
+#endif // _FILL_X86
+
+#if defined(_FILL_NEON)
+
+/* fill n pixels starting at dst with color32, 4 at a time using NEON.
+ */
+static void fillSpanNEON (uint32_t *dst, uint32_t color32, int n)
+{
+        uint32x4_t v = vdupq_n_u32 (color32);
+        for (; n >= 8; n -= 8, dst += 8) {
+            vst1q_u32 (dst, v);
+            vst1q_u32 (dst+4, v);
+        }
+        for (; n >= 4; n -= 4, dst += 4)
+            vst1q_u32 (dst, v);
+        while (n-- > 0)
+            *dst++ = color32;
+}
+
+#endif // _FILL_NEON
+
+/* return the best span fill kernel for this cpu, and its name.
+ */
+static Adafruit_RA8875::FillSpanFunc chooseFillSpan (const char **name)
+{
+#if defined(_FILL_X86)
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports ("avx2")) {
+            *name = "AVX2";
+            return (fillSpanAVX2);
+        }
+        if (__builtin_cpu_supports ("sse2")) {
+            *name = "SSE2";
+            return (fillSpanSSE2);
+        }
+#endif
+#if defined(_FILL_NEON)
+        *name = "NEON";
+        return (fillSpanNEON);
+#endif
+        *name = "scalar";
+        return (fillSpanScalar);
+}
+
+/********************************************************************************************************
+ *
+ * earth span kernels, chosen once at runtime according to cpu capabilities
+ *
+ */
+
+#define EARTH_565X      0x07E0F81F                              // RGB565 spread as 00000gggggg00000rrrrr000000bbbbb
+
+/* blend one day and night texel by wday/FB_EARTH_WMAX and return as fb pixel.
+ * the channels are spread apart within 32 bits so all three blend with one multiply each.
+ */
+static inline uint32_t earthBlend (uint16_t day, uint16_t night, int wday)
+{
+        uint32_t d = (day | ((uint32_t)day << 16)) & EARTH_565X;
+        uint32_t n = (night | ((uint32_t)night << 16)) & EARTH_565X;
+        uint32_t x = ((d*wday + n*(FB_EARTH_WMAX-wday)) >> 5) & EARTH_565X;
+        uint16_t c16 = (x & 0xF81F) | ((x >> 16) & 0x07E0);
+        return (RGB1632(c16));
+}
+
+/* return the day weight of the texel at row ey and column ex.
+ */
+static inline int earthShade (const Adafruit_RA8875::EarthSun *sun, int ey, int ex)
+{
+        float cos_t = sun->a[ey] + sun->b[ey]*sun->c[ex];
+        int i = (int)((cos_t - sun->cos0)*sun->k);
+        return (sun->w[i < 0 ? 0 : (i > FB_SUN_N ? FB_SUN_N : i)]);
+}
+
+/* draw n earth pixels starting at dst, one at a time.
+ */
+static void earthSpanScalar (uint32_t *dst, const Adafruit_RA8875::EarthSpan &es, int n)
+{
+        // no need to blend all day or all night
+        const uint16_t *tex = es.wday == FB_EARTH_WMAX ? es.day : (es.wday == 0 ? es.night : NULL);
+
+        int32_t u = es.u, v = es.v;
+        for (int i = 0; i < n; i++, u += es.du, v += es.dv) {
+            int32_t wu = u < 0 ? u + es.u1 : (u >= es.u1 ? u - es.u1 : u);
+            int32_t wv = v < 0 ? v + es.v1 : (v >= es.v1 ? v - es.v1 : v);
+            int ex = wu >> 16, ey = wv >> 16;
+            int t = ey*es.w + ex;
+            if (tex)
+                *dst++ = RGB1632(tex[t]);
+            else {
+                int wday = es.wday < 0 ? earthShade (es.sun, ey, ex) : es.wday;
+                *dst++ = earthBlend (es.day[t], es.night[t], wday);
+            }
+        }
+}
+
+#if defined(_FILL_X86)
+
+/* draw n earth pixels starting at dst, all at once using SSE4.1.
+ * there is no 16 bit gather so the texels are fetched one at a time, everything else is in lanes.
+ * N.B. each lane is only wrapped once so (n-1)*du and (n-1)*dv must be less than a texture size.
+ */
+__attribute__((target("sse4.1")))
+static void earthSpanSSE41 (uint32_t *dst, const Adafruit_RA8875::EarthSpan &es, int n)
+{
+        const __m128i lane = _mm_setr_epi32 (0, 1, 2, 3);
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i u1 = _mm_set1_epi32 (es.u1);
+        const __m128i v1 = _mm_set1_epi32 (es.v1);
+        const __m128i m565x = _mm_set1_epi32 (EARTH_565X);
+
+        // texel coords of each lane, wrapped once each way
+        __m128i u = _mm_add_epi32 (_mm_set1_epi32 (es.u), _mm_mullo_epi32 (lane, _mm_set1_epi32 (es.du)));
+        __m128i v = _mm_add_epi32 (_mm_set1_epi32 (es.v), _mm_mullo_epi32 (lane, _mm_set1_epi32 (es.dv)));
+        u = _mm_add_epi32 (u, _mm_and_si128 (_mm_cmplt_epi32 (u, zero), u1));
+        u = _mm_sub_epi32 (u, _mm_andnot_si128 (_mm_cmplt_epi32 (u, u1), u1));
+        v = _mm_add_epi32 (v, _mm_and_si128 (_mm_cmplt_epi32 (v, zero), v1));
+        v = _mm_sub_epi32 (v, _mm_andnot_si128 (_mm_cmplt_epi32 (v, v1), v1));
+        // unused lanes use texel 0
+        const __m128i used = _mm_cmplt_epi32 (lane, _mm_set1_epi32 (n));
+        __m128i ex = _mm_and_si128 (_mm_srli_epi32 (u, 16), used);
+        __m128i ey = _mm_and_si128 (_mm_srli_epi32 (v, 16), used);
+        __m128i t = _mm_add_epi32 (_mm_mullo_epi32 (ey, _mm_set1_epi32 (es.w)), ex);
+
+        // fetch
+        int32_t ti[FB_EARTH_LANES];
+        _mm_storeu_si128 ((__m128i *)ti, t);
+        __m128i c16;
+        if (es.wday == FB_EARTH_WMAX || es.wday == 0) {
+            // no need to blend all day or all night
+            const uint16_t *tex = es.wday ? es.day : es.night;
+            c16 = _mm_setr_epi32 (tex[ti[0]], tex[ti[1]], tex[ti[2]], tex[ti[3]]);
+        } else {
+            // day weight of each lane, as in earthShade()
+            __m128i w;
+            if (es.wday < 0) {
+                const Adafruit_RA8875::EarthSun *sun = es.sun;
+                int32_t xi[FB_EARTH_LANES], yi[FB_EARTH_LANES];
+                _mm_storeu_si128 ((__m128i *)xi, ex);
+                _mm_storeu_si128 ((__m128i *)yi, ey);
+                __m128 a = _mm_setr_ps (sun->a[yi[0]], sun->a[yi[1]], sun->a[yi[2]], sun->a[yi[3]]);
+                __m128 b = _mm_setr_ps (sun->b[yi[0]], sun->b[yi[1]], sun->b[yi[2]], sun->b[yi[3]]);
+                __m128 c = _mm_setr_ps (sun->c[xi[0]], sun->c[xi[1]], sun->c[xi[2]], sun->c[xi[3]]);
+                __m128 cos_t = _mm_add_ps (a, _mm_mul_ps (b, c));
+                __m128i i = _mm_cvttps_epi32 (_mm_mul_ps (_mm_sub_ps (cos_t, _mm_set1_ps (sun->cos0)),
+                                    _mm_set1_ps (sun->k)));
+                i = _mm_min_epi32 (_mm_max_epi32 (i, zero), _mm_set1_epi32 (FB_SUN_N));
+                _mm_storeu_si128 ((__m128i *)xi, i);
+                w = _mm_setr_epi32 (sun->w[xi[0]], sun->w[xi[1]], sun->w[xi[2]], sun->w[xi[3]]);
+            } else
+                w = _mm_set1_epi32 (es.wday);
+
+            // blend as in earthBlend()
+            __m128i d = _mm_setr_epi32 (es.day[ti[0]], es.day[ti[1]], es.day[ti[2]], es.day[ti[3]]);
+            __m128i e = _mm_setr_epi32 (es.night[ti[0]], es.night[ti[1]], es.night[ti[2]], es.night[ti[3]]);
+            d = _mm_and_si128 (_mm_or_si128 (d, _mm_slli_epi32 (d, 16)), m565x);
+            e = _mm_and_si128 (_mm_or_si128 (e, _mm_slli_epi32 (e, 16)), m565x);
+            __m128i x = _mm_add_epi32 (_mm_mullo_epi32 (d, w),
+                                    _mm_mullo_epi32 (e, _mm_sub_epi32 (_mm_set1_epi32 (FB_EARTH_WMAX), w)));
+            x = _mm_and_si128 (_mm_srli_epi32 (x, 5), m565x);
+            c16 = _mm_or_si128 (_mm_and_si128 (x, _mm_set1_epi32 (0xF81F)),
+                                    _mm_and_si128 (_mm_srli_epi32 (x, 16), _mm_set1_epi32 (0x07E0)));
+        }
+        __m128i c32 = _mm_or_si128 (_mm_or_si128 (
+                            _mm_slli_epi32 (_mm_and_si128 (c16, _mm_set1_epi32 (0xF800)), 8),
+                            _mm_slli_epi32 (_mm_and_si128 (c16, _mm_set1_epi32 (0x07E0)), 5)),
+                            _mm_slli_epi32 (_mm_and_si128 (c16, _mm_set1_epi32 (0x001F)), 3));
+
+        if (n == FB_EARTH_LANES)
+            _mm_storeu_si128 ((__m128i *)dst, c32);
+        else {
+            uint32_t c[FB_EARTH_LANES];
+            _mm_storeu_si128 ((__m128i *)c, c32);
+            memcpy (dst, c, n * sizeof(uint32_t));
+        }
+}
+
+#endif // _FILL_X86
+
+#if defined(_FILL_NEON)
+
+/* draw n earth pixels starting at dst, all at once using NEON.
+ * there is no 16 bit gather so the texels are fetched one at a time, everything else is in lanes.
+ * N.B. each lane is only wrapped once so (n-1)*du and (n-1)*dv must be less than a texture size.
+ */
+static void earthSpanNEON (uint32_t *dst, const Adafruit_RA8875::EarthSpan &es, int n)
+{
+        static const int32_t lanes[FB_EARTH_LANES] = {0, 1, 2, 3};
+        const int32x4_t lane = vld1q_s32 (lanes);
+        const int32x4_t zero = vdupq_n_s32 (0);
+        const int32x4_t u1 = vdupq_n_s32 (es.u1);
+        const int32x4_t v1 = vdupq_n_s32 (es.v1);
+        const uint32x4_t m565x = vdupq_n_u32 (EARTH_565X);
+
+        // texel coords of each lane, wrapped once each way
+        int32x4_t u = vmlaq_n_s32 (vdupq_n_s32 (es.u), lane, es.du);
+        int32x4_t v = vmlaq_n_s32 (vdupq_n_s32 (es.v), lane, es.dv);
+        u = vaddq_s32 (u, vandq_s32 (vreinterpretq_s32_u32 (vcltq_s32 (u, zero)), u1));
+        u = vsubq_s32 (u, vandq_s32 (vreinterpretq_s32_u32 (vcgeq_s32 (u, u1)), u1));
+        v = vaddq_s32 (v, vandq_s32 (vreinterpretq_s32_u32 (vcltq_s32 (v, zero)), v1));
+        v = vsubq_s32 (v, vandq_s32 (vreinterpretq_s32_u32 (vcgeq_s32 (v, v1)), v1));
+        // unused lanes use texel 0
+        const uint32x4_t used = vcltq_s32 (lane, vdupq_n_s32 (n));
+        uint32x4_t ex = vandq_u32 (vshrq_n_u32 (vreinterpretq_u32_s32 (u), 16), used);
+        uint32x4_t ey = vandq_u32 (vshrq_n_u32 (vreinterpretq_u32_s32 (v), 16), used);
+        uint32x4_t t = vmlaq_n_u32 (ex, ey, es.w);
+
+        // fetch
+        uint32_t ti[FB_EARTH_LANES], c[FB_EARTH_LANES];
+        vst1q_u32 (ti, t);
+        uint32x4_t c16;
+        if (es.wday == FB_EARTH_WMAX || es.wday == 0) {
+            // no need to blend all day or all night
+            const uint16_t *tex = es.wday ? es.day : es.night;
+            for (int i = 0; i < FB_EARTH_LANES; i++)
+                c[i] = tex[ti[i]];
+            c16 = vld1q_u32 (c);
+        } else {
+            // day weight of each lane, as in earthShade()
+            uint32x4_t w;
+            if (es.wday < 0) {
+                const Adafruit_RA8875::EarthSun *sun = es.sun;
+                uint32_t xi[FB_EARTH_LANES], yi[FB_EARTH_LANES];
+                float f[FB_EARTH_LANES];
+                vst1q_u32 (xi, ex);
+                vst1q_u32 (yi, ey);
+                for (int i = 0; i < FB_EARTH_LANES; i++)
+                    f[i] = sun->a[yi[i]];
+                float32x4_t a = vld1q_f32 (f);
+                for (int i = 0; i < FB_EARTH_LANES; i++)
+                    f[i] = sun->b[yi[i]];
+                float32x4_t b = vld1q_f32 (f);
+                for (int i = 0; i < FB_EARTH_LANES; i++)
+                    f[i] = sun->c[xi[i]];
+                float32x4_t cos_t = vmlaq_f32 (a, b, vld1q_f32 (f));
+                int32x4_t i4 = vcvtq_s32_f32 (vmulq_n_f32 (vsubq_f32 (cos_t, vdupq_n_f32 (sun->cos0)), sun->k));
+                i4 = vminq_s32 (vmaxq_s32 (i4, zero), vdupq_n_s32 (FB_SUN_N));
+                vst1q_u32 (xi, vreinterpretq_u32_s32 (i4));
+                for (int i = 0; i < FB_EARTH_LANES; i++)
+                    c[i] = sun->w[xi[i]];
+                w = vld1q_u32 (c);
+            } else
+                w = vdupq_n_u32 (es.wday);
+
+            // blend as in earthBlend()
+            for (int i = 0; i < FB_EARTH_LANES; i++)
+                c[i] = es.day[ti[i]];
+            uint32x4_t d = vld1q_u32 (c);
+            for (int i = 0; i < FB_EARTH_LANES; i++)
+                c[i] = es.night[ti[i]];
+            uint32x4_t e = vld1q_u32 (c);
+            d = vandq_u32 (vorrq_u32 (d, vshlq_n_u32 (d, 16)), m565x);
+            e = vandq_u32 (vorrq_u32 (e, vshlq_n_u32 (e, 16)), m565x);
+            uint32x4_t x = vmlaq_u32 (vmulq_u32 (d, w), e, vsubq_u32 (vdupq_n_u32 (FB_EARTH_WMAX), w));
+            x = vandq_u32 (vshrq_n_u32 (x, 5), m565x);
+            c16 = vorrq_u32 (vandq_u32 (x, vdupq_n_u32 (0xF81F)),
+                                    vandq_u32 (vshrq_n_u32 (x, 16), vdupq_n_u32 (0x07E0)));
+        }
+        uint32x4_t c32 = vorrq_u32 (vorrq_u32 (
+                            vshlq_n_u32 (vandq_u32 (c16, vdupq_n_u32 (0xF800)), 8),
+                            vshlq_n_u32 (vandq_u32 (c16, vdupq_n_u32 (0x07E0)), 5)),
+                            vshlq_n_u32 (vandq_u32 (c16, vdupq_n_u32 (0x001F)), 3));
+
+        if (n == FB_EARTH_LANES)
+            vst1q_u32 (dst, c32);
+        else {
+            vst1q_u32 (c, c32);
+            memcpy (dst, c, n * sizeof(uint32_t));
+        }
+}
+
+#endif // _FILL_NEON
+
+/* return the best earth span kernel for this cpu, and its name.
+ */
+static Adafruit_RA8875::EarthSpanFunc chooseEarthSpan (const char **name)
+{
+        // rows are SCALESZ wide, the lanes only pay for themselves when all are used
+        if (FB_XRES/APP_WIDTH < FB_EARTH_LANES) {
+            *name = "scalar";
+            return (earthSpanScalar);
+        }
+
+#if defined(_FILL_X86)
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports ("sse4.1")) {
+            *name = "SSE4.1";
+            return (earthSpanSSE41);
+        }
+#endif
+#if defined(_FILL_NEON)
+        *name = "NEON";
+        return (earthSpanNEON);
+#endif
+        *name = "scalar";
+        return (earthSpanScalar);
+}
+
+/* fill the fb span on row y from x through x+w-1 with color32, clipped to the canvas.
+ * N.B. we assume fb_lock is held
+ */
+void Adafruit_RA8875::fillSpan (int x, int y, int w, uint32_t color32)
+{
+        if (y < 0 || y >= FB_YRES)
+            return;
+        if (x < 0) {
+            w += x;
+            x = 0;
+        }
+        if (x + w > FB_XRES)
+            w = FB_XRES - x;
+        if (w <= 0)
+            return;
+
+        int i = y*FB_XRES + x;
+        uint8_t *trow = fb_otiles[y/FB_DTILE];
+        int tx0 = x/FB_DTILE;
+        int ntx = (x+w-1)/FB_DTILE - tx0 + 1;
+        if (fb_over_depth > 0) {
+            (*fill_span) (&fb_over[i], color32, w);
+            memset (&trow[tx0], 1, ntx);
+        } else {
+            (*fill_span) (&fb_canvas[i], color32, w);
+            if (memchr (&trow[tx0], 1, ntx))
+                (*fill_span) (&fb_over[i], FB_OVER_CLEAR, w);
+        }
 }
 
 /********************************************************************************************************
@@ -853,12 +1434,31 @@ void Adafruit_RA8875::plotLineHigh(int16_t x0, int16_t y0, int16_t x1, int16_t y
 	}
 }
 
+/* fill the portion of fb row y between half-widths hi and ho either side of x0, or all of -ho .. ho if hi < 0.
+ * N.B. we assume fb_lock is held
+ */
+void Adafruit_RA8875::fillRingRow (int x0, int y, int ho, int hi, uint32_t color32)
+{
+	if (hi < 0) {
+	    fillSpan (x0-ho, y, 2*ho+1, color32);
+	} else {
+	    fillSpan (x0-ho, y, ho-hi, color32);
+	    fillSpan (x0+hi+1, y, ho-hi, color32);
+	}
+}
+
 /* plot line using Bresenham's algorithm.
  * https://en.wikipedia.org/wiki/Bresenham%27s_line_algorithm
  */
 void Adafruit_RA8875::plotLine(int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint32_t color32)
 {
-	if (abs(y1 - y0) < abs(x1 - x0)) {
+	if (y0 == y1) {
+	    // horizontal runs are just a span
+	    if (x0 > x1)
+		fillSpan (x1, y0, x0-x1+1, color32);
+	    else
+		fillSpan (x0, y0, x1-x0+1, color32);
+	} else if (abs(y1 - y0) < abs(x1 - x0)) {
 	    if (x0 > x1)
 		plotLineLow(x1, y1, x0, y0, color32);
 	    else
@@ -871,17 +1471,448 @@ void Adafruit_RA8875::plotLine(int16_t x0, int16_t y0, int16_t x1, int16_t y1, u
 	}
 }
 
+/* set one fb pixel in the canvas, or the overlay if within beginOverlay().
+ * N.B. we assume fb_lock is held and x,y are within the canvas
+ */
 void Adafruit_RA8875::plot32 (int16_t x, int16_t y, uint32_t color32)
 {
-        fb_canvas[y*FB_XRES + x] = color32;
+        int i = y*FB_XRES + x;
+        uint8_t &ot = fb_otiles[y/FB_DTILE][x/FB_DTILE];
+        if (fb_over_depth > 0) {
+            fb_over[i] = color32;
+            ot = 1;
+        } else {
+            fb_canvas[i] = color32;
+            if (ot)
+                fb_over[i] = FB_OVER_CLEAR;
+        }
+}
+
+/* mark the tiles covering the fb region with the given corners as needing staging.
+ * corners are inclusive and may be in any order, region is clipped to the canvas.
+ * N.B. we assume fb_lock is held
+ */
+void Adafruit_RA8875::markDirty (int x0, int y0, int x1, int y1)
+{
+        if (x1 < x0) {
+            int t = x0; x0 = x1; x1 = t;
+        }
+        if (y1 < y0) {
+            int t = y0; y0 = y1; y1 = t;
+        }
+        if (x1 < 0 || y1 < 0 || x0 >= FB_XRES || y0 >= FB_YRES)
+            return;
+        if (x0 < 0)
+            x0 = 0;
+        if (y0 < 0)
+            y0 = 0;
+        if (x1 >= FB_XRES)
+            x1 = FB_XRES-1;
+        if (y1 >= FB_YRES)
+            y1 = FB_YRES-1;
+
+        // the map layer need only restore what was drawn on the canvas, not the overlay
+        int tx0 = x0/FB_DTILE;
+        int ntx = x1/FB_DTILE - tx0 + 1;
+        for (int ty = y0/FB_DTILE; ty <= y1/FB_DTILE; ty++) {
+            memset (&fb_dtiles[ty][tx0], 1, ntx);
+            if (fb_over_depth == 0)
+                memset (&fb_mtiles[ty][tx0], 1, ntx);
+        }
+
+        // wake fbThread only on the first change since it last looked
+        if (!fb_dirty) {
+            fb_dirty = true;
+            wakeFB();
+        }
+}
+
+/* merge the dirty tiles into at most FB_MAX_DRECTS rectangles, return count.
+ * each run of dirty tiles on a tile row is joined to an identical run directly above, if any. if we
+ * run out of room the remainder is unioned into the last rectangle.
+ * tiles are marked clean as they are collected except those touching the protected region while it is
+ * still protected, so they remain dirty until drawPR().
+ * N.B. we assume fb_lock is held
+ */
+int Adafruit_RA8875::collectDirtyRects (FBRect rects[])
+{
+        // tile range covered by the protected region, if any and if it is still protected
+        int pr_tx0 = 1, pr_tx1 = 0, pr_ty0 = 1, pr_ty1 = 0;
+        if (!pr_flag && pr_w > 0 && pr_h > 0) {
+            pr_tx0 = pr_x/FB_DTILE;
+            pr_tx1 = (pr_x + pr_w - 1)/FB_DTILE;
+            pr_ty0 = pr_y/FB_DTILE;
+            pr_ty1 = (pr_y + pr_h - 1)/FB_DTILE;
+        }
+
+        // index into rects[] of the rectangle ending on the previous tile row starting at each tile column
+        int16_t open_above[FB_DTILES_X], open_here[FB_DTILES_X];
+        for (int tx = 0; tx < FB_DTILES_X; tx++)
+            open_above[tx] = -1;
+
+        int n_rects = 0;
+        for (int ty = 0; ty < FB_DTILES_Y; ty++) {
+
+            uint8_t *trow = fb_dtiles[ty];
+            bool pr_row = ty >= pr_ty0 && ty <= pr_ty1;
+
+            for (int tx = 0; tx < FB_DTILES_X; tx++)
+                open_here[tx] = -1;
+
+            int tx = 0;
+            while (tx < FB_DTILES_X) {
+
+                if (!trow[tx]) {
+                    tx++;
+                    continue;
+                }
+
+                // find run of dirty tiles, cleaning as we go unless protected
+                int tx0 = tx;
+                while (tx < FB_DTILES_X && trow[tx]) {
+                    if (!pr_row || tx < pr_tx0 || tx > pr_tx1)
+                        trow[tx] = 0;
+                    tx++;
+                }
+
+                // fb coords of run
+                uint16_t x = tx0*FB_DTILE;
+                uint16_t y = ty*FB_DTILE;
+                uint16_t w = (tx == FB_DTILES_X ? FB_XRES : tx*FB_DTILE) - x;
+                uint16_t h = (ty == FB_DTILES_Y-1 ? FB_YRES : y+FB_DTILE) - y;
+
+                // extend an identical run directly above, else start new, else union with last
+                int i = open_above[tx0];
+                if (i >= 0 && rects[i].x == x && rects[i].w == w && rects[i].y + rects[i].h == y) {
+                    rects[i].h += h;
+                    open_here[tx0] = i;
+                } else if (n_rects < FB_MAX_DRECTS) {
+                    FBRect &r = rects[n_rects];
+                    r.x = x;
+                    r.y = y;
+                    r.w = w;
+                    r.h = h;
+                    open_here[tx0] = n_rects++;
+                } else {
+                    FBRect &r = rects[n_rects-1];
+                    uint16_t r_r = r.x + r.w > x + w ? r.x + r.w : x + w;
+                    uint16_t r_b = r.y + r.h > y + h ? r.y + r.h : y + h;
+                    if (x < r.x)
+                        r.x = x;
+                    if (y < r.y)
+                        r.y = y;
+                    r.w = r_r - r.x;
+                    r.h = r_b - r.y;
+                }
+            }
+
+            memcpy (open_above, open_here, sizeof(open_above));
+        }
+
+        return (n_rects);
+}
+
+/* copy the given fb region from fb_canvas and fb_over to fb_stage and add to fb_srects[], skipping any
+ * portion within the protected region unless pr_flag is set.
+ * N.B. we assume fb_lock is held
+ */
+void Adafruit_RA8875::addStageRect (int x, int y, int w, int h)
+{
+        if (w <= 0 || h <= 0)
+            return;
+
+        // split into the portions above, below, left and right of the protected region if overlapping.
+        // none of these pieces overlap it so this recursion is only one deep.
+        if (!pr_flag && pr_w > 0 && pr_h > 0) {
+            int pr_r = pr_x + pr_w;
+            int pr_b = pr_y + pr_h;
+            if (x < pr_r && x + w > pr_x && y < pr_b && y + h > pr_y) {
+                int top = y > pr_y ? y : pr_y;
+                int bot = y + h < pr_b ? y + h : pr_b;
+                addStageRect (x, y, w, pr_y - y);                               // above
+                addStageRect (x, pr_b, w, y + h - pr_b);                        // below
+                addStageRect (x, top, pr_x - x, bot - top);                     // left
+                addStageRect (pr_r, top, x + w - pr_r, bot - top);              // right
+                return;
+            }
+        }
+
+        // copy to staging area
+        for (int i = 0; i < h; i++)
+            stageRow (x, y + i, w);
+
+        // record
+        FBRect &r = fb_srects[fb_nsrects++];
+        r.x = x;
+        r.y = y;
+        r.w = w;
+        r.h = h;
+}
+
+/* copy w fb pixels on row y starting at x from fb_canvas to fb_stage, with any fb_over pixels on top.
+ * runs of tiles without overlay are copied whole.
+ * N.B. we assume fb_lock is held
+ */
+void Adafruit_RA8875::stageRow (int x, int y, int w)
+{
+        const uint8_t *trow = fb_otiles[y/FB_DTILE];
+        const uint32_t *c_row = fb_canvas + y*FB_XRES;
+        const uint32_t *o_row = fb_over + y*FB_XRES;
+        uint32_t *s_row = fb_stage + y*FB_XRES;
+        int x_end = x + w;
+
+        while (x < x_end) {
+
+            // find run of tiles all with or all without overlay
+            bool over = trow[x/FB_DTILE] != 0;
+            int run_end = (x/FB_DTILE + 1)*FB_DTILE;
+            while (run_end < x_end && (trow[run_end/FB_DTILE] != 0) == over)
+                run_end += FB_DTILE;
+            if (run_end > x_end)
+                run_end = x_end;
+
+            if (over) {
+                for (int c = x; c < run_end; c++) {
+                    uint32_t o = o_row[c];
+                    s_row[c] = o != FB_OVER_CLEAR ? o : c_row[c];
+                }
+            } else
+                memcpy (&s_row[x], &c_row[x], (run_end - x)*sizeof(uint32_t));
+
+            x = run_end;
+        }
 }
 
 /* plot hi res earth lat0,lng0 at app's screen location x0,y0.
  * we interpolate this to SCALESZxSCALESZ, knowing dlat and dlng going one full step right and down.
- * frac_day is 1 for all DEARTH, 0 for all NEARTH else blend
+ * each point is blended from DEARTH by day to NEARTH by night for the sun given to setEarthSun().
  */
 void Adafruit_RA8875::plotEarth (uint16_t x0, uint16_t y0, float lat0, float lng0,
-float dlatr, float dlngr, float dlatd, float dlngd, float fract_day)
+float dlatr, float dlngr, float dlatd, float dlngd)
+{
+	float slack;
+	lockFB();
+	    plotEarthTo (fb_canvas, x0, y0, lat0, lng0, dlatr, dlngr, dlatd, dlngd, slack);
+	    markDirty (x0*SCALESZ, y0*SCALESZ, x0*SCALESZ+SCALESZ-1, y0*SCALESZ+SCALESZ-1);
+	unlockFB();
+}
+
+/* return the size of the array each thread drawing with plotEarthLayer() needs to record the tiles it
+ * changes, one byte for each tile.
+ */
+int Adafruit_RA8875::mapLayerTiles()
+{
+	return (FB_DTILES_Y * FB_DTILES_X);
+}
+
+/* same as plotEarth() but into the map layer opened with openMapLayer().
+ * the tiles changed are marked in mtiles, of size mapLayerTiles(), to give to markMapLayer() later.
+ * return false if the sun has not moved far enough since this block was last drawn in the layer to
+ * change its shading, so nothing was drawn.
+ * N.B. no lock is used so any thread may call this provided each draws different pixels and marks its
+ *   own mtiles.
+ */
+bool Adafruit_RA8875::plotEarthLayer (uint16_t x0, uint16_t y0, float lat0, float lng0,
+float dlatr, float dlngr, float dlatd, float dlngd, uint8_t *mtiles)
+{
+	if (!mapLayerStale (x0, y0))
+	    return (false);
+	double &exp = fb_map_exp[y0*APP_WIDTH + x0];
+
+	float slack;
+	plotEarthTo (fb_map, x0, y0, lat0, lng0, dlatr, dlngr, dlatd, dlngd, slack);
+	exp = fb_sun_motion + slack;
+
+	int tx0 = x0*SCALESZ/FB_DTILE, tx1 = (x0*SCALESZ + SCALESZ-1)/FB_DTILE;
+	int ty0 = y0*SCALESZ/FB_DTILE, ty1 = (y0*SCALESZ + SCALESZ-1)/FB_DTILE;
+	for (int ty = ty0; ty <= ty1; ty++)
+	    for (int tx = tx0; tx <= tx1; tx++)
+		mtiles[ty*FB_DTILES_X + tx] = 1;
+
+	return (true);
+}
+
+/* merge the tiles marked by plotEarthLayer() into those to be copied by the next showMapLayer().
+ */
+void Adafruit_RA8875::markMapLayer (const uint8_t *mtiles)
+{
+	lockFB();
+	    for (int ty = 0; ty < FB_DTILES_Y; ty++)
+		for (int tx = 0; tx < FB_DTILES_X; tx++)
+		    fb_mtiles[ty][tx] |= mtiles[ty*FB_DTILES_X + tx];
+	unlockFB();
+}
+
+/* return whether the map layer block at app x,y must be drawn again by plotEarthLayer().
+ * this lets callers skip finding its location when it is not.
+ */
+bool Adafruit_RA8875::mapLayerStale (uint16_t x, uint16_t y)
+{
+	return (fb_sun_motion >= fb_map_exp[y*APP_WIDTH + x]);
+}
+
+/* set the subsolar point sslat, sslng in rads for shading the earth drawn with plotEarth().
+ * the grayline is where the cos of the angle to the subsolar point is between gl_cos and 0, across
+ * which the fraction of night goes as (cos/gl_cos)^gl_pow.
+ * the tables are only rebuilt when the sun has moved.
+ * N.B. must not be called while other threads are drawing into the map layer.
+ */
+void Adafruit_RA8875::setEarthSun (float sslat, float sslng, float gl_cos, float gl_pow)
+{
+	if (fb_sun[0].a && sslat == fb_sun_lat && sslng == fb_sun_lng)
+	    return;
+
+	// add the arc moved since last time, by haversine because it is small
+	double hlat = sin ((sslat - fb_sun_lat)/2), hlng = sin ((sslng - fb_sun_lng)/2);
+	double h = hlat*hlat + cos(sslat)*cos(fb_sun_lat)*hlng*hlng;
+	fb_sun_motion += 2*asin (sqrt (h < 1 ? h : 1));
+
+	fb_sun_lat = sslat;
+	fb_sun_lng = sslng;
+
+	if (!fb_sun[0].a) {
+	    initEarthMips();
+	    for (int l = 0; l < fb_nmips; l++) {
+		EarthSun &sun = fb_sun[l];
+		sun.a = (float *) malloc (fb_mip[l].h * sizeof(float));
+		sun.b = (float *) malloc (fb_mip[l].h * sizeof(float));
+		sun.c = (float *) malloc (fb_mip[l].w * sizeof(float));
+		if (!sun.a || !sun.b || !sun.c) {
+		    printf ("Can not malloc earth sun tables\n");
+		    exit(1);
+		}
+	    }
+	}
+
+	// latitude of each texel row, longitude of each texel column, at each mip level
+	float ss = sinf (sslat), cs = cosf (sslat);
+	for (int l = 0; l < fb_nmips; l++) {
+	    EarthSun &sun = fb_sun[l];
+	    int w = fb_mip[l].w, h = fb_mip[l].h;
+	    for (int ey = 0; ey < h; ey++) {
+		float lat = (90.0F - 180.0F*ey/h)*(float)M_PI/180;
+		sun.a[ey] = ss*sinf(lat);
+		sun.b[ey] = cs*cosf(lat);
+	    }
+	    for (int ex = 0; ex < w; ex++) {
+		float lng = (360.0F*ex/w - 180.0F)*(float)M_PI/180;
+		sun.c[ex] = cosf (sslng - lng);
+	    }
+	}
+
+	// day weight at each step from gl_cos to 0, the same at each level
+	fb_sun[0].cos0 = gl_cos;
+	fb_sun[0].k = FB_SUN_N/(-gl_cos);
+	for (int i = 0; i <= FB_SUN_N; i++)
+	    fb_sun[0].w[i] = (int)((1 - powf (1 - (float)i/FB_SUN_N, gl_pow))*FB_EARTH_WMAX + 0.5F);
+	for (int l = 1; l < fb_nmips; l++) {
+	    fb_sun[l].cos0 = fb_sun[0].cos0;
+	    fb_sun[l].k = fb_sun[0].k;
+	    memcpy (fb_sun[l].w, fb_sun[0].w, sizeof(fb_sun[l].w));
+	}
+}
+
+/* return the average of the src texels in columns [x0,x1) and rows [y0,y1), channel by channel.
+ */
+static uint16_t earthBox (const uint16_t *src, int sw, int x0, int x1, int y0, int y1)
+{
+	uint32_t r = 0, g = 0, b = 0, n = (x1-x0)*(y1-y0);
+	for (int y = y0; y < y1; y++) {
+	    for (int x = x0; x < x1; x++) {
+		uint16_t c = src[y*sw + x];
+		r += c >> 11;
+		g += (c >> 5) & 0x3F;
+		b += c & 0x1F;
+	    }
+	}
+	return ((((r + n/2)/n) << 11) | (((g + n/2)/n) << 5) | ((b + n/2)/n));
+}
+
+/* fill dst, a dh x dw texture, from src, a sh x sw texture, each dst texel averaging the src texels it
+ * covers. that is 2 each way, or sometimes 3 if a src size is odd, so the levels stay aligned in lat and lng.
+ */
+static void earthMipDown (const uint16_t *src, int sw, int sh, uint16_t *dst, int dw, int dh)
+{
+	for (int y = 0; y < dh; y++) {
+	    int y0 = y*sh/dh, y1 = (y+1)*sh/dh;
+	    for (int x = 0; x < dw; x++)
+		*dst++ = earthBox (src, sw, x*sw/dw, (x+1)*sw/dw, y0, y1);
+	}
+}
+
+/* build the coarser mip levels from the full size earth maps, if not already.
+ * N.B. this reads all of both maps
+ */
+void Adafruit_RA8875::initEarthMips()
+{
+	for (; fb_nmips < FB_EARTH_MIPS; fb_nmips++) {
+	    const EarthMip &fine = fb_mip[fb_nmips-1];
+	    EarthMip &m = fb_mip[fb_nmips];
+	    m.w = fine.w/2;
+	    m.h = fine.h/2;
+	    uint16_t *day = (uint16_t *) malloc (m.w * m.h * sizeof(uint16_t));
+	    uint16_t *night = (uint16_t *) malloc (m.w * m.h * sizeof(uint16_t));
+	    if (!day || !night) {
+		printf ("Can not malloc earth mip level %d\n", fb_nmips);
+		exit(1);
+	    }
+	    earthMipDown (fine.day, fine.w, fine.h, day, m.w, m.h);
+	    earthMipDown (fine.night, fine.w, fine.h, night, m.w, m.h);
+	    m.day = day;
+	    m.night = night;
+	}
+}
+
+/* return texel coord t wrapped to [0,size) as 16.16 fixed point.
+ */
+static int32_t earthTexel (float t, int size)
+{
+        int32_t f = (int32_t)(t*65536);
+        while (f < 0)
+            f += size << 16;
+        while (f >= (size << 16))
+            f -= size << 16;
+        return (f);
+}
+
+/* return the day weight of the whole earth block whose first texel of mip level l is at u,v and spans
+ * the given changes in degrees, or -1 if it is near enough the grayline that each sub-pixel must be shaded.
+ * also return the arc the sun may move before this could change. cos_t changes no faster than that arc,
+ * so a block in the grayline is good until cos_t might cross a step of w[].
+ */
+int Adafruit_RA8875::earthBlockShade (int l, int32_t u, int32_t v, float dlatr, float dlngr, float dlatd,
+float dlngd, float &slack)
+{
+        const EarthSun &sun = fb_sun[l];
+
+        // all day if no sun yet
+        if (!sun.a) {
+            slack = 0;
+            return (FB_EARTH_WMAX);
+        }
+
+        // cos_t changes by no more than the arc across the block, plus a texel for good measure
+        float arc = (fabsf(dlatr) + fabsf(dlngr) + fabsf(dlatd) + fabsf(dlngd) + 360.0F/fb_mip[l].h)
+                                * (float)M_PI/180;
+        float cos_t = sun.a[v>>16] + sun.b[v>>16]*sun.c[u>>16];
+        if (cos_t - arc > 0) {
+            slack = cos_t - arc;
+            return (FB_EARTH_WMAX);
+        }
+        if (cos_t + arc < sun.cos0) {
+            slack = sun.cos0 - (cos_t + arc);
+            return (0);
+        }
+        slack = 1/sun.k;
+        return (-1);
+}
+
+/* draw one SCALESZ x SCALESZ earth block into dst, a FB_XRES x FB_YRES image.
+ * also return the arc the sun may move before its shading could change.
+ * N.B. FB_EARTH_LANES is enough for SCALESZ up to 3200/800.
+ */
+void Adafruit_RA8875::plotEarthTo (uint32_t *dst, uint16_t x0, uint16_t y0, float lat0, float lng0,
+float dlatr, float dlngr, float dlatd, float dlngd, float &slack)
 {
         // beware lng wrap across date line
         if (dlngr < -180) dlngr += 360;
@@ -889,73 +1920,395 @@ float dlatr, float dlngr, float dlatd, float dlngd, float fract_day)
         if (dlngr >  180) dlngr -= 360;
         if (dlngd >  180) dlngd -= 360;
 
-        // scale app step size to our step size
-        dlatr /= SCALESZ;
-        dlngr /= SCALESZ;
-        dlatd /= SCALESZ;
-        dlngd /= SCALESZ;
+        // use the finest mip level whose texels are at least as large as a sub-pixel
+        float g = fmaxf (fmaxf (fabsf(dlngr), fabsf(dlngd))*EARTH_BIG_W/360,
+                         fmaxf (fabsf(dlatr), fabsf(dlatd))*EARTH_BIG_H/180) / SCALESZ;
+        int l = 0;
+        while (l+1 < fb_nmips && g >= 2) {
+            g /= 2;
+            l++;
+        }
+        const EarthMip &mip = fb_mip[l];
+
+        // texel coords of the block origin and their steps per sub-pixel right and down, 16.16
+        const float uscale = 65536.0F*mip.w/360/SCALESZ;
+        const float vscale = -65536.0F*mip.h/180/SCALESZ;
+        EarthSpan es;
+        es.day = mip.day;
+        es.night = mip.night;
+        es.w = mip.w;
+        es.u1 = mip.w << 16;
+        es.v1 = mip.h << 16;
+        es.u = earthTexel ((lng0+180)*mip.w/360 + 0.5F, mip.w);
+        es.v = earthTexel ((90-lat0)*mip.h/180 + 0.5F, mip.h);
+        es.du = (int32_t)(dlngr*uscale);
+        es.dv = (int32_t)(dlatr*vscale);
+        es.sun = &fb_sun[l];
+        es.wday = earthBlockShade (l, es.u, es.v, dlatr, dlngr, dlatd, dlngd, slack);
+        int32_t dud = (int32_t)(dlngd*uscale);
+        int32_t dvd = (int32_t)(dlatd*vscale);
 
         // ditto starting loc
 	x0 *= SCALESZ;
 	y0 *= SCALESZ;
 
+	// one row at a time, wrapping the start of each
 	for (int r = 0; r < SCALESZ; r++) {
-	    uint32_t *frow = &fb_canvas[(y0+r)*FB_XRES + x0];
-	    for (int c = 0; c < SCALESZ; c++) {
-                float lat = lat0 + dlatr*c + dlatd*r;
-                float lng = lng0 + dlngr*c + dlngd*r;
-                int ex = (int)((lng+180)*EARTH_BIG_W/360 + EARTH_BIG_W + 0.5F);
-                int ey = (int)((90-lat)*EARTH_BIG_H/180 + EARTH_BIG_H + 0.5F);
-                ex = (ex + EARTH_BIG_W) % EARTH_BIG_W;
-                ey = (ey + EARTH_BIG_H) % EARTH_BIG_H;
-		uint16_t c16; 
-		if (fract_day == 0) {
-		    c16 = NEARTH_BIG[ey][ex];
-		} else if (fract_day == 1) {
-		    c16 = DEARTH_BIG[ey][ex];
-		} else {
-		    // blend from day to night
-		    uint16_t day_pix = DEARTH_BIG[ey][ex];
-		    uint16_t night_pix = NEARTH_BIG[ey][ex];
-		    uint8_t day_r = RGB565_R(day_pix);
-		    uint8_t day_g = RGB565_G(day_pix);
-		    uint8_t day_b = RGB565_B(day_pix);
-		    uint8_t night_r = RGB565_R(night_pix);
-		    uint8_t night_g = RGB565_G(night_pix);
-		    uint8_t night_b = RGB565_B(night_pix);
-		    float fract_night = 1 - fract_day;
-		    uint8_t twi_r = (fract_day*day_r + fract_night*night_r);
-		    uint8_t twi_g = (fract_day*day_g + fract_night*night_g);
-		    uint8_t twi_b = (fract_day*day_b + fract_night*night_b);
-		    c16 = RGB565 (twi_r, twi_g, twi_b);
-		}
-		*frow++ = RGB1632(c16);
+	    (*earth_span) (&dst[(y0+r)*FB_XRES + x0], es, SCALESZ);
+	    es.u += dud;
+	    es.v += dvd;
+	    if (es.u < 0) es.u += es.u1; else if (es.u >= es.u1) es.u -= es.u1;
+	    if (es.v < 0) es.v += es.v1; else if (es.v >= es.v1) es.v -= es.v1;
+	}
+}
+
+/* make ready the map layer for drawing the given region in app coords.
+ * if fresh mark the region as not yet drawn, else keep what it has so plotEarthLayer() need only draw
+ * blocks whose shading may have changed since.
+ * return false if no memory.
+ */
+bool Adafruit_RA8875::openMapLayer (uint16_t x, uint16_t y, uint16_t w, uint16_t h, bool fresh)
+{
+	if (!fb_map) {
+	    fb_map = (uint32_t *) malloc (FB_XRES * FB_YRES * sizeof(uint32_t));
+	    fb_map_exp = (double *) malloc (APP_WIDTH * APP_HEIGHT * sizeof(double));
+	    if (!fb_map || !fb_map_exp) {
+		printf ("Can not malloc(%d) for map layer\n", FB_XRES * FB_YRES);
+		free (fb_map);
+		free (fb_map_exp);
+		fb_map = NULL;
+		fb_map_exp = NULL;
+		return (false);
 	    }
+	    fresh = true;
 	}
+
+	if (fresh) {
+	    for (int r = y*SCALESZ; r < (y+h)*SCALESZ; r++)
+		(*fill_span) (&fb_map[r*FB_XRES + x*SCALESZ], FB_MAP_CLEAR, w*SCALESZ);
+	    for (int r = y; r < y+h; r++)
+		for (int c = x; c < x+w; c++)
+		    fb_map_exp[r*APP_WIDTH + c] = -1;
+	    for (int ty = y*SCALESZ/FB_DTILE; ty <= ((y+h)*SCALESZ-1)/FB_DTILE; ty++)
+		memset (&fb_mtiles[ty][x*SCALESZ/FB_DTILE], 1, ((x+w)*SCALESZ-1)/FB_DTILE - x*SCALESZ/FB_DTILE + 1);
+	}
+
+	return (true);
+}
+
+/* draw one app pixel into the map layer, without locking.
+ */
+void Adafruit_RA8875::drawLayerPixel (int16_t x, int16_t y, uint16_t color16)
+{
+	uint32_t c32 = RGB1632(color16);
+	for (int r = 0; r < SCALESZ; r++)
+	    for (int c = 0; c < SCALESZ; c++)
+		fb_map[(y*SCALESZ+r)*FB_XRES + x*SCALESZ + c] = c32;
+}
+
+/* copy each pixel drawn in the map layer within the given region in app coords to the canvas.
+ * only tiles changed in either since last time need be copied: those redrawn in the layer, and those
+ * drawn over in the canvas which must be restored.
+ */
+void Adafruit_RA8875::showMapLayer (uint16_t x, uint16_t y, uint16_t w, uint16_t h)
+{
+	x *= SCALESZ;
+	y *= SCALESZ;
+	w *= SCALESZ;
+	h *= SCALESZ;
+
+	int tx0 = x/FB_DTILE, tx1 = (x+w-1)/FB_DTILE;
+	int ty0 = y/FB_DTILE, ty1 = (y+h-1)/FB_DTILE;
+
+	lockFB();
+	    for (int ty = ty0; ty <= ty1; ty++) {
+		int r0 = ty*FB_DTILE > y ? ty*FB_DTILE : y;
+		int r1 = (ty+1)*FB_DTILE < y+h ? (ty+1)*FB_DTILE : y+h;
+		for (int tx = tx0; tx <= tx1; tx++) {
+		    if (!fb_mtiles[ty][tx])
+			continue;
+		    int c0 = tx*FB_DTILE > x ? tx*FB_DTILE : x;
+		    int c1 = (tx+1)*FB_DTILE < x+w ? (tx+1)*FB_DTILE : x+w;
+		    for (int r = r0; r < r1; r++) {
+			const uint32_t *mrow = &fb_map[r*FB_XRES];
+			uint32_t *frow = &fb_canvas[r*FB_XRES];
+			for (int c = c0; c < c1; c++)
+			    if (mrow[c] != FB_MAP_CLEAR)
+				frow[c] = mrow[c];
+		    }
+		    markDirty (c0, r0, c1-1, r1-1);
+		}
+	    }
+	    for (int ty = ty0; ty <= ty1; ty++)
+		memset (&fb_mtiles[ty][tx0], 0, tx1 - tx0 + 1);
+	unlockFB();
 }
 
 void Adafruit_RA8875::plotChar (char ch)
+{
+	lockFB();
+	    plotGlyph (ch);
+	unlockFB();
+}
+
+/* draw the first n chars of s at the cursor under one hold of fb_lock.
+ */
+void Adafruit_RA8875::plotString (const char *s, int n)
+{
+	lockFB();
+	    for (int i = 0; i < n; i++)
+		plotGlyph (s[i]);
+	unlockFB();
+}
+
+/* draw ch at the cursor from its cached runs and advance the cursor.
+ * N.B. we assume fb_lock is held
+ */
+void Adafruit_RA8875::plotGlyph (char ch)
 {
 	if (ch < current_font->first || ch > current_font->last)
 	    ch = '?';
-	GFXglyph *gp = &current_font->glyph[ch-current_font->first];
-	uint8_t *bp = &current_font->bitmap[gp->bitmapOffset];
+	int i = ch - current_font->first;
+	GFXglyph *gp = &current_font->glyph[i];
+	FBGlyph *cg = getGlyph (current_font, i);
 	int16_t x = cursor_x + gp->xOffset;
 	int16_t y = cursor_y + gp->yOffset;
-	uint16_t bitn = 0;
-	pthread_mutex_lock (&fb_lock);
-	    for (uint16_t r = 0; r < gp->height; r++) {
-		for (uint16_t c = 0; c < gp->width; c++) {
-		    uint8_t bit = bp[bitn/8] & (1 << (7-(bitn%8)));
-		    if (bit)
-			plot32 (x+c, y+r, text_color32);
+
+	for (int r = 0; r < cg->nruns; r++) {
+	    FBGlyphRun *rp = &cg->runs[r];
+	    fillSpan (x + rp->x, y + rp->y, rp->w, text_color32);
+	}
+	if (cg->nruns > 0)
+	    markDirty (x, y, x+gp->width-1, y+gp->height-1);
+
+	cursor_x += gp->xAdvance;
+}
+
+/* return the cached runs for glyph index i of font, building them on first use.
+ */
+Adafruit_RA8875::FBGlyph *Adafruit_RA8875::getGlyph (const GFXfont *font, int i)
+{
+	// find font, else claim the next slot, evicting the oldest if full
+	if (!fb_gfont || fb_gfont->font != font) {
+	    fb_gfont = NULL;
+	    for (int f = 0; f < FB_MAX_GFONTS; f++) {
+		if (fb_gfonts[f].font == font) {
+		    fb_gfont = &fb_gfonts[f];
+		    break;
+		}
+	    }
+	    if (!fb_gfont) {
+		fb_gfont = &fb_gfonts[fb_ngfonts++ % FB_MAX_GFONTS];
+		if (fb_gfont->glyphs) {
+		    for (int g = 0; g <= fb_gfont->font->last - fb_gfont->font->first; g++)
+			free (fb_gfont->glyphs[g].runs);
+		    free (fb_gfont->glyphs);
+		}
+		int ng = font->last - font->first + 1;
+		fb_gfont->glyphs = (FBGlyph *) malloc (ng * sizeof(FBGlyph));
+		if (!fb_gfont->glyphs) {
+		    printf ("No memory for %d glyphs\n", ng);
+		    exit(1);
+		}
+		for (int g = 0; g < ng; g++) {
+		    fb_gfont->glyphs[g].runs = NULL;
+		    fb_gfont->glyphs[g].nruns = -1;
+		}
+		fb_gfont->font = font;
+	    }
+	}
+
+	FBGlyph *cg = &fb_gfont->glyphs[i];
+	if (cg->nruns >= 0)
+	    return (cg);
+
+	// walk the bitmap once, collecting runs of set bits along each row
+	GFXglyph *gp = &font->glyph[i];
+	uint8_t *bp = &font->bitmap[gp->bitmapOffset];
+	int maxruns = gp->height * ((gp->width+1)/2);
+	cg->runs = maxruns > 0 ? (FBGlyphRun *) malloc (maxruns * sizeof(FBGlyphRun)) : NULL;
+	if (maxruns > 0 && !cg->runs) {
+	    printf ("No memory for %d glyph runs\n", maxruns);
+	    exit(1);
+	}
+	cg->nruns = 0;
+	uint32_t bitn = 0;
+	for (int r = 0; r < gp->height; r++) {
+	    int c0 = -1;
+	    for (int c = 0; c <= gp->width; c++) {
+		bool bit = c < gp->width && (bp[bitn/8] & (1 << (7-(bitn%8))));
+		if (c < gp->width)
 		    bitn++;
+		if (bit && c0 < 0)
+		    c0 = c;
+		else if (!bit && c0 >= 0) {
+		    FBGlyphRun *rp = &cg->runs[cg->nruns++];
+		    rp->x = c0;
+		    rp->y = r;
+		    rp->w = c - c0;
+		    c0 = -1;
 		}
 	    }
-	    fb_dirty = true;
-	pthread_mutex_unlock (&fb_lock);
+	}
+	return (cg);
+}
 
-	cursor_x += gp->xAdvance;
+/* start a batch of drawing operations that all run under one hold of fb_lock.
+ * batches may nest but each must be closed with endBatch(); do not call drawPR() within a batch.
+ * N.B. only the application thread may draw so fb_batch needs no protection of its own.
+ */
+void Adafruit_RA8875::beginBatch(void)
+{
+        if (fb_batch++ == 0)
+            pthread_mutex_lock (&fb_lock);
+}
+
+/* end a batch of drawing operations started with beginBatch().
+ */
+void Adafruit_RA8875::endBatch(void)
+{
+        if (fb_batch > 0 && --fb_batch == 0)
+            pthread_mutex_unlock (&fb_lock);
+}
+
+/* get memory for the overlay, all clear.
+ */
+void Adafruit_RA8875::initOverlay()
+{
+	fb_over = (uint32_t *) malloc (FB_XRES * FB_YRES * sizeof(uint32_t));
+	if (!fb_over) {
+	    printf ("Can not malloc(%d) for overlay\n", (int)(FB_XRES * FB_YRES * sizeof(uint32_t)));
+	    exit(1);
+	}
+	(*fill_span) (fb_over, FB_OVER_CLEAR, FB_XRES * FB_YRES);
+	memset (fb_otiles, 0, sizeof(fb_otiles));
+}
+
+/* map the day and night earth textures for this size.
+ */
+void Adafruit_RA8875::initEarthMaps()
+{
+	fb_mip[0].day = mmapEarthMap ("dearth");
+	fb_mip[0].night = mmapEarthMap ("nearth");
+	fb_mip[0].w = EARTH_BIG_W;
+	fb_mip[0].h = EARTH_BIG_H;
+	fb_nmips = 1;
+}
+
+/* find the earth texture file <name>-<EARTH_BIG_W>x<EARTH_BIG_H>.bin in $HOME/.hamclock or else
+ * /usr/local/share/hamclock and map it read-only. the Makefile earthmaps-* targets make these files.
+ * the file is raw RGB565 pixels in native byte order, row by row from the north pole at longitude -180.
+ * the kernel only reads each page as the map first touches it and the page cache is shared by all
+ * hamclocks using the same file.
+ */
+const uint16_t *Adafruit_RA8875::mmapEarthMap (const char *name)
+{
+	const char *home = getenv ("HOME");
+	const size_t n_bytes = EARTH_BIG_W * EARTH_BIG_H * sizeof(uint16_t);
+	char fn[1024];
+	int fd = -1;
+
+	if (home) {
+	    snprintf (fn, sizeof(fn), "%s/.hamclock/%s-%dx%d.bin", home, name, EARTH_BIG_W, EARTH_BIG_H);
+	    fd = open (fn, O_RDONLY);
+	}
+	if (fd < 0) {
+	    snprintf (fn, sizeof(fn), "/usr/local/share/hamclock/%s-%dx%d.bin", name, EARTH_BIG_W,
+                        EARTH_BIG_H);
+	    fd = open (fn, O_RDONLY);
+	}
+	if (fd < 0) {
+	    printf ("Can not find %s-%dx%d.bin in $HOME/.hamclock or /usr/local/share/hamclock\n", name,
+                        EARTH_BIG_W, EARTH_BIG_H);
+	    printf ("Make it with make earthmaps-%dx%d then make install-earthmaps\n", FB_XRES, FB_YRES);
+	    exit(1);
+	}
+
+	// insist on exactly the right size, a short file would fault when touched beyond its end
+	struct stat st;
+	if (fstat (fd, &st) < 0 || st.st_size != (off_t)n_bytes) {
+	    printf ("%s: expected %d bytes\n", fn, (int)n_bytes);
+	    exit(1);
+	}
+
+	void *map = mmap (NULL, n_bytes, PROT_READ, MAP_SHARED, fd, 0);
+	if (map == MAP_FAILED) {
+	    printf ("%s: mmap: %s\n", fn, strerror(errno));
+	    exit(1);
+	}
+
+	// the mapping remains after close
+	close (fd);
+
+	printf ("Earth map: %s\n", fn);
+	return ((const uint16_t *) map);
+}
+
+/* draw into the overlay until the matching endOverlay(), rather than the canvas.
+ * overlays may nest and may be used within a batch.
+ */
+void Adafruit_RA8875::beginOverlay(void)
+{
+        fb_over_depth++;
+}
+
+/* end drawing into the overlay started with beginOverlay().
+ */
+void Adafruit_RA8875::endOverlay(void)
+{
+        if (fb_over_depth > 0)
+            fb_over_depth--;
+}
+
+/* erase the overlay within the given app region, revealing the canvas beneath.
+ * tiles wholly erased no longer need compositing, others stay marked in case anything else remains.
+ */
+void Adafruit_RA8875::eraseOverlay (int16_t x, int16_t y, int16_t w, int16_t h)
+{
+	// fb region, clipped, end exclusive
+	int x0 = x*SCALESZ, x1 = (x+w)*SCALESZ;
+	int y0 = y*SCALESZ, y1 = (y+h)*SCALESZ;
+	if (x0 < 0)
+	    x0 = 0;
+	if (y0 < 0)
+	    y0 = 0;
+	if (x1 > FB_XRES)
+	    x1 = FB_XRES;
+	if (y1 > FB_YRES)
+	    y1 = FB_YRES;
+	if (x1 <= x0 || y1 <= y0)
+	    return;
+
+	bool changed = false;
+	lockFB();
+	    for (int ty = y0/FB_DTILE; ty <= (y1-1)/FB_DTILE; ty++) {
+		int t_y0 = ty*FB_DTILE;
+		int t_y1 = t_y0 + FB_DTILE < FB_YRES ? t_y0 + FB_DTILE : FB_YRES;
+		int r0 = t_y0 > y0 ? t_y0 : y0;
+		int r1 = t_y1 < y1 ? t_y1 : y1;
+		for (int tx = x0/FB_DTILE; tx <= (x1-1)/FB_DTILE; tx++) {
+		    if (!fb_otiles[ty][tx])
+			continue;
+		    int t_x0 = tx*FB_DTILE;
+		    int t_x1 = t_x0 + FB_DTILE < FB_XRES ? t_x0 + FB_DTILE : FB_XRES;
+		    int c0 = t_x0 > x0 ? t_x0 : x0;
+		    int c1 = t_x1 < x1 ? t_x1 : x1;
+		    for (int r = r0; r < r1; r++)
+			(*fill_span) (&fb_over[r*FB_XRES + c0], FB_OVER_CLEAR, c1 - c0);
+
+		    if (r0 == t_y0 && r1 == t_y1 && c0 == t_x0 && c1 == t_x1)
+			fb_otiles[ty][tx] = 0;
+		    fb_dtiles[ty][tx] = 1;
+		    changed = true;
+		}
+	    }
+
+	    // wake fbThread as per markDirty()
+	    if (changed && !fb_dirty) {
+		fb_dirty = true;
+		wakeFB();
+	    }
+	unlockFB();
 }
 
 /* store the desired protect drawing region
@@ -971,15 +2324,89 @@ void Adafruit_RA8875::setPR (uint16_t x, uint16_t y, uint16_t w, uint16_t h)
         }
 }
 
+/* return microseconds since an arbitrary epoch, for timing frames.
+ */
+static uint32_t fbMicros()
+{
+        struct timespec ts;
+        clock_gettime (CLOCK_MONOTONIC_RAW, &ts);
+        return ((uint32_t)(ts.tv_sec*1000000LL + ts.tv_nsec/1000));
+}
+
 /* draw the protected region synchronously
+ * N.B. must not be called within a batch
  */
 void Adafruit_RA8875::drawPR(void)
 {
-        // set flag to inform the drawing thread to draw the pr region, wait until finished.
-        // if you know of a better way with mutexes etc let me know
-        pr_flag = 1;
-        while (pr_flag)
-            usleep (100);
+        // set flag to inform the drawing thread to draw the pr region, wait until it has been shown.
+        pthread_mutex_lock (&fb_lock);
+            int want = pr_seq + 1;
+            pr_flag = 1;
+            wakeFB();
+            while (pr_shown < want)
+                pthread_cond_wait (&pr_cond, &fb_lock);
+        pthread_mutex_unlock (&fb_lock);
+}
+
+/* return how long fbThread took to stage and to show the frame last drawn by drawPR(), in usecs.
+ */
+void Adafruit_RA8875::getPRTimes (uint32_t &stage_us, uint32_t &show_us)
+{
+        pthread_mutex_lock (&fb_lock);
+            stage_us = pr_stage_us;
+            show_us = pr_show_us;
+        pthread_mutex_unlock (&fb_lock);
+}
+
+/* set up the means for drawing methods to wake fbThread and for fbThread to report drawPR() done.
+ */
+void Adafruit_RA8875::initWake()
+{
+        if (pipe (fb_wake) < 0) {
+            printf ("fb_wake pipe: %s\n", strerror(errno));
+            exit(1);
+        }
+        fcntl (fb_wake[0], F_SETFL, fcntl (fb_wake[0], F_GETFL) | O_NONBLOCK);
+        fcntl (fb_wake[1], F_SETFL, fcntl (fb_wake[1], F_GETFL) | O_NONBLOCK);
+
+        if (pthread_cond_init (&pr_cond, NULL)) {
+            printf ("pr_cond: %s\n", strerror(errno));
+            exit(1);
+        }
+}
+
+/* wake fbThread if it is waiting in waitFB().
+ * a full pipe means a wake is already pending so that is not an error.
+ */
+void Adafruit_RA8875::wakeFB()
+{
+        char c = 0;
+        if (fb_wake[1] >= 0 && write (fb_wake[1], &c, 1) < 0 && errno != EAGAIN)
+            printf ("fb_wake: %s\n", strerror(errno));
+}
+
+/* called by fbThread to wait until woken by wakeFB(), fd becomes readable or ms elapse.
+ * fd < 0 or ms < 0 mean no fd or wait forever, respectively.
+ */
+void Adafruit_RA8875::waitFB (int fd, int ms)
+{
+        struct pollfd pfd[2];
+        int npfd = 0;
+        pfd[npfd].fd = fb_wake[0];
+        pfd[npfd++].events = POLLIN;
+        if (fd >= 0) {
+            pfd[npfd].fd = fd;
+            pfd[npfd++].events = POLLIN;
+        }
+        if (poll (pfd, npfd, ms) < 0 && errno != EINTR) {
+            printf ("fb poll(2): %s\n", strerror(errno));
+            exit(1);
+        }
+
+        // drain so the next wake starts afresh
+        char buf[64];
+        while (read (fb_wake[0], buf, sizeof(buf)) > 0)
+            continue;
 }
 
 
@@ -1018,28 +2445,99 @@ void *Adafruit_RA8875::fbThreadHelper(void *me)
 	return (NULL);
 }
 
-/* display fb_canvas.
+volatile bool Adafruit_RA8875::shm_error;
+
+/* X error handler used only while attaching the shared memory segment.
+ */
+int Adafruit_RA8875::shmErrorHandler (Display *d, XErrorEvent *e)
+{
+	shm_error = true;
+	return (0);
+}
+
+/* try to create img and fb_stage in memory shared with the X server.
+ * return whether successful, else caller should fall back to XPutImage over the socket.
+ * N.B. the server may claim MIT-SHM but still fail to attach, such as when it is on another host.
+ */
+bool Adafruit_RA8875::initShm (Visual *visual)
+{
+	if (!XShmQueryExtension (display))
+	    return (false);
+
+	img = XShmCreateImage (display, visual, 24, ZPixmap, NULL, &shminfo, FB_XRES, FB_YRES);
+	if (!img)
+	    return (false);
+	if (img->bytes_per_line != FB_XRES*(int)sizeof(uint32_t) || img->bits_per_pixel != 32) {
+	    XDestroyImage (img);
+	    return (false);
+	}
+
+	shminfo.shmid = shmget (IPC_PRIVATE, img->bytes_per_line*img->height, IPC_CREAT|0600);
+	if (shminfo.shmid < 0) {
+	    printf ("shmget(%d): %s\n", img->bytes_per_line*img->height, strerror(errno));
+	    XDestroyImage (img);
+	    return (false);
+	}
+	shminfo.shmaddr = img->data = (char *) shmat (shminfo.shmid, NULL, 0);
+	if (shminfo.shmaddr == (char *)-1) {
+	    printf ("shmat: %s\n", strerror(errno));
+	    shmctl (shminfo.shmid, IPC_RMID, NULL);
+	    XDestroyImage (img);
+	    return (false);
+	}
+	shminfo.readOnly = True;
+
+	// attach, trapping any error synchronously
+	shm_error = false;
+	XErrorHandler prev_handler = XSetErrorHandler (shmErrorHandler);
+	bool ok = XShmAttach (display, &shminfo);
+	XSync (display, False);
+	XSetErrorHandler (prev_handler);
+
+	// segment is destroyed automatically after both we and the server detach
+	shmctl (shminfo.shmid, IPC_RMID, NULL);
+
+	if (!ok || shm_error) {
+	    printf ("X11: MIT-SHM attach failed, using XPutImage\n");
+	    shmdt (shminfo.shmaddr);
+	    img->data = NULL;
+	    XDestroyImage (img);
+	    return (false);
+	}
+
+	fb_stage = (uint32_t *) shminfo.shmaddr;
+	return (true);
+}
+
+/* display the dirty portions of fb_canvas.
  * N.B. we assume fb_lock is held
  */
 void Adafruit_RA8875::setStagingArea()
 {
-        // copy to staging area (used by img)
-        memcpy (fb_stage, fb_canvas, fb_nbytes);
-
-        // put only the unproteced region unless pr_flag is set
-        if (pr_flag) {
-            // draw everything
-            XPutImage(display, pixmap, gc, img, 0, 0, 0, 0, FB_XRES, FB_YRES);
-        } else {
-            // draw only around the protected area
-            uint16_t pr_r = pr_x + pr_w;
-            uint16_t pr_b = pr_y + pr_h;
-            XPutImage(display, pixmap, gc, img, 0, 0, 0, 0, FB_XRES, pr_y);                   // above
-            XPutImage(display, pixmap, gc, img, 0, pr_y, 0, pr_y, pr_x, pr_h);                // left
-            XPutImage(display, pixmap, gc, img, pr_r, pr_y, pr_r, pr_y, FB_XRES-pr_r, pr_h);  // right
-            XPutImage(display, pixmap, gc, img, 0, pr_b, 0, pr_b, FB_XRES, FB_YRES-pr_b);     // bottom
+        // copy dirty regions to staging area (used by img), avoiding the protected region unless pr_flag
+        uint32_t t0 = fbMicros();
+        FBRect drects[FB_MAX_DRECTS];
+        int n_drects = collectDirtyRects (drects);
+        fb_nsrects = 0;
+        for (int i = 0; i < n_drects; i++)
+            addStageRect (drects[i].x, drects[i].y, drects[i].w, drects[i].h);
+        uint32_t t1 = fbMicros();
+        fb_stage_us = t1 - t0;
+
+        // put just those regions
+        for (int i = 0; i < fb_nsrects; i++) {
+            FBRect &r = fb_srects[i];
+            if (use_shm)
+                XShmPutImage(display, pixmap, gc, img, r.x, r.y, r.x, r.y, r.w, r.h, False);
+            else
+                XPutImage(display, pixmap, gc, img, r.x, r.y, r.x, r.y, r.w, r.h);
+            XCopyArea(display, pixmap, win, gc, r.x, r.y, r.w, r.h, FB_X0+r.x, FB_Y0+r.y);
         }
-        XCopyArea(display, pixmap, win, gc, 0, 0, FB_XRES, FB_YRES, FB_X0, FB_Y0);
+
+        // the server reads shared memory asynchronously so wait until it is done before fb_stage can change
+        if (use_shm && fb_nsrects > 0)
+            XSync(display, False);
+        fb_show_us = fbMicros() - t1;
 }
 
 /* thread that runs forever reacting to X11 events and painting fb_canvas whenever it changes
@@ -1053,13 +2551,9 @@ void Adafruit_RA8875::fbThread ()
 
         for(;;)
         {
-            bool work = false;
-
 	    // handle events but don't block if none
 	    while (XPending (display) > 0) {
 
-                work = true;
-
 		XNextEvent(display, &event);
 
 		switch (event.type) {
@@ -1115,19 +2609,25 @@ void Adafruit_RA8875::fbThread ()
 		}
 	    }
 
-	    // show any changes
+	    // show any changes, the protected region counts as shown once the server has it
 	    pthread_mutex_lock (&fb_lock);
                 if (fb_dirty || pr_flag) {
                     setStagingArea();
                     fb_dirty = false;
-                    pr_flag = 0;
-                    work = true;
+                    if (pr_flag) {
+                        XFlush (display);
+                        pr_stage_us = fb_stage_us;
+                        pr_show_us = fb_show_us;
+                        pr_flag = 0;
+                        pr_shown = ++pr_seq;
+                        pthread_cond_broadcast (&pr_cond);
+                    }
                 }
 	    pthread_mutex_unlock (&fb_lock);
 
-	    // don't go crazy if nothing to do
-            if (!work)
-                usleep (20000);
+	    // sleep until drawing or an X event, unless Xlib already queued some while we were busy
+            if (XEventsQueued (display, QueuedAfterFlush) == 0)
+                waitFB (ConnectionNumber(display), -1);
         }
 
 }
@@ -1368,6 +2868,8 @@ void Adafruit_RA8875::mouseThread (void)
 
 		pthread_mutex_unlock (&mouse_lock);
 
+                wakeFB();
+
             } else {
 
                 // close and rety later if disappeared
@@ -1419,6 +2921,7 @@ void Adafruit_RA8875::kbThread ()
                         kb_cqtail = 0;
 		    fb_dirty = true;
 		pthread_mutex_unlock (&kb_lock);
+                wakeFB();
                 // printf ("KB: %d %c\n", buf[0], buf[0]);
 	    } else {
                 if (nr < 0)
@@ -1439,47 +2942,130 @@ void *Adafruit_RA8875::fbThreadHelper(void *me)
 	return (NULL);
 }
 
-/* cursor drawing helper:
- * given location of cursor shape relative to 0,0 at hw mouse coord, set fb_cursor to color if fits within.
+/* build the cursor arrow sprite in fb_sprite, FB_CURSOR_SZ on a side with its tip at 0,0.
+ * N.B.: CAN NOT use the nice drawing tools because they use fb_canvas
  */
-void Adafruit_RA8875::setCursorIfVis (uint16_t row, uint16_t col, uint32_t color)
+void Adafruit_RA8875::initCursor()
 {
-        // rely on unsigned wrap detect negative values
+        fb_sprite = (uint32_t *) malloc (FB_CURSOR_SZ*FB_CURSOR_SZ*sizeof(uint32_t));
+        if (!fb_sprite) {
+            printf ("Can not malloc(%d) for cursor\n", FB_CURSOR_SZ*FB_CURSOR_SZ);
+            exit(1);
+        }
+        for (int i = 0; i < FB_CURSOR_SZ*FB_CURSOR_SZ; i++)
+            fb_sprite[i] = FB_SPRITE_CLEAR;
+
+        const uint32_t fgcolor = 0x000000;
+        const uint32_t bgcolor = 0xFF2222;
+        // fill top half
+        for (uint16_t r = 0; r < FB_CURSOR_SZ/2; r++)
+            for (uint16_t c = r/2+1; c < 2*r-1; c++)
+                setSpritePixel (r, c, bgcolor);
+        // fill bottom half
+        for (uint16_t r = FB_CURSOR_SZ/2; r < FB_CURSOR_SZ; r++)
+            for (uint16_t c = r/2+1; c < 3*FB_CURSOR_SZ/2-r-1; c++)
+                setSpritePixel (r, c, bgcolor);
+        // draw border
+        for (uint16_t i = 0; i < FB_CURSOR_SZ/2; i++) {
+            setSpritePixel(i, 2*i, fgcolor);
+            setSpritePixel(i, 2*i+1, fgcolor);
+            setSpritePixel(2*i, i, fgcolor);
+            setSpritePixel(2*i+1, i, fgcolor);
+            setSpritePixel(FB_CURSOR_SZ-i-1, i+FB_CURSOR_SZ/2, fgcolor);
+        }
+}
 
-        row += mouse_y - FB_Y0;
-        col += mouse_x - FB_X0;
-        if (row < FB_YRES && col < FB_XRES)
-            fb_cursor[row*FB_XRES + col] = color;
+/* cursor drawing helper: set the given sprite pixel to color if it fits within.
+ */
+void Adafruit_RA8875::setSpritePixel (uint16_t row, uint16_t col, uint32_t color)
+{
+        if (row < FB_CURSOR_SZ && col < FB_CURSOR_SZ)
+            fb_sprite[row*FB_CURSOR_SZ + col] = color;
 }
 
-/* display fb_canvas.
+/* draw the opaque pixels of the cursor sprite into the hw page starting at page, clipped to box.
+ */
+void Adafruit_RA8875::drawCursor (uint32_t *page, const FBRect &box)
+{
+        for (int r = 0; r < box.h; r++) {
+            const uint32_t *sp = fb_sprite + r*FB_CURSOR_SZ;
+            uint32_t *fb_row = page + (FB_Y0+box.y+r)*fb_si.xres + FB_X0 + box.x;
+            for (int c = 0; c < box.w; c++)
+                if (sp[c] != FB_SPRITE_CLEAR)
+                    fb_row[c] = sp[c];
+        }
+}
+
+/* set up page flipping if the driver lets us pan a virtual fb twice the visible height,
+ * also see whether we can wait for vertical sync. fb_fd and fb_si must already be set up.
+ */
+void Adafruit_RA8875::initFlip()
+{
+        fb_flip = false;
+        fb_page = 0;
+
+        // ask for two pages, then check what we really got
+        struct fb_var_screeninfo vsi = fb_si;
+        vsi.xres_virtual = vsi.xres;
+        vsi.yres_virtual = 2*vsi.yres;
+        vsi.xoffset = vsi.yoffset = 0;
+        struct fb_fix_screeninfo fsi;
+        if (ioctl (fb_fd, FBIOPUT_VSCREENINFO, &vsi) < 0)
+            printf ("FBIOPUT_VSCREENINFO: %s\n", strerror(errno));
+        else if (ioctl (fb_fd, FBIOGET_VSCREENINFO, &vsi) < 0)
+            printf ("FBIOGET_VSCREENINFO: %s\n", strerror(errno));
+        else if (ioctl (fb_fd, FBIOGET_FSCREENINFO, &fsi) < 0)
+            printf ("FBIOGET_FSCREENINFO: %s\n", strerror(errno));
+        else if (vsi.yres_virtual >= 2*vsi.yres && vsi.xres_virtual == vsi.xres
+                        && fsi.line_length == vsi.xres*sizeof(*fb_fb)
+                        && fsi.smem_len >= fsi.line_length*vsi.yres_virtual
+                        && ioctl (fb_fd, FBIOPAN_DISPLAY, &vsi) == 0) {
+            fb_si = vsi;
+            fb_flip = true;
+        }
+
+        // try one vsync wait
+        int zero = 0;
+        fb_vsync = ioctl (fb_fd, FBIO_WAITFORVSYNC, &zero) == 0;
+
+        printf ("fb0 %s, %s vsync\n", fb_flip ? "flipping pages" : "copying to one page",
+                                fb_vsync ? "with" : "without");
+}
+
+/* wait for vertical sync if supported
+ */
+void Adafruit_RA8875::waitVSync()
+{
+        int zero = 0;
+        if (fb_vsync && ioctl (fb_fd, FBIO_WAITFORVSYNC, &zero) < 0) {
+            printf ("FBIO_WAITFORVSYNC: %s\n", strerror(errno));
+            fb_vsync = false;
+        }
+}
+
+/* copy rectangle r of the FB_XRES x FB_YRES image src to its place on the hw page starting at page.
+ */
+void Adafruit_RA8875::copyStageRect (uint32_t *page, const uint32_t *src, const FBRect &r)
+{
+        const uint32_t *s_row = src + r.y*FB_XRES + r.x;
+        uint32_t *fb_row = page + (FB_Y0+r.y)*fb_si.xres + FB_X0 + r.x;
+        for (int y = 0; y < r.h; y++, s_row += FB_XRES, fb_row += fb_si.xres)
+            memcpy (fb_row, s_row, r.w*fb_pixlen);
+}
+
+/* copy the dirty portions of fb_canvas to fb_stage, recording them in fb_srects[].
  * N.B. we assume fb_lock is held
  */
 void Adafruit_RA8875::setStagingArea()
 {
-        // put only the unproteced region unless pr_flag is set
-        if (pr_flag) {
-            // draw everything
-            memcpy (fb_stage, fb_canvas, fb_nbytes);
-        } else {
-            // draw only around the protected area
-            size_t bpp = sizeof(uint32_t);                                      // bytes per pixel
-            uint16_t bw = FB_XRES*bpp;                                          // bytes wide
-            uint16_t pr_r = pr_x + pr_w;                                        // right of PR
-            uint16_t pr_b = pr_y + pr_h;                                        // bottom of PR
-            uint32_t *s_row = fb_stage;                                         // next stage row
-            uint32_t *c_row = fb_canvas;                                        // next canvas row
-            for (uint16_t y = 0; y < FB_YRES; y++, c_row += FB_XRES, s_row += FB_XRES) {
-                if (y < pr_y) {
-                    memcpy (s_row, c_row, bw);                                  // above
-                } else if (y < pr_b) {
-                    memcpy (s_row, c_row, pr_x*bpp);                            // left
-                    memcpy (s_row+pr_r, c_row+pr_r, (FB_XRES-pr_r)*bpp);        // right
-                } else {
-                    memcpy (s_row, c_row, bw);                                  // below
-                }
-            }
-        }
+        // stage only the dirty regions, avoiding the protected region unless pr_flag is set
+        uint32_t t0 = fbMicros();
+        FBRect drects[FB_MAX_DRECTS];
+        int n_drects = collectDirtyRects (drects);
+        fb_nsrects = 0;
+        for (int i = 0; i < n_drects; i++)
+            addStageRect (drects[i].x, drects[i].y, drects[i].w, drects[i].h);
+        fb_stage_us = fbMicros() - t0;
 }
 
 /* thread that runs forever to update display buffer whenever fb_canvas changes
@@ -1489,6 +3075,9 @@ void Adafruit_RA8875::fbThread ()
         // init cursor timeout off soon
         clock_gettime (CLOCK_MONOTONIC_RAW, &mouse_ts);
 
+        // no cursor drawn on either page yet
+        fb_cursor_on[0] = fb_cursor_on[1] = false;
+
         // update screen periodically
 	for (;;) {
 
@@ -1497,10 +3086,14 @@ void Adafruit_RA8875::fbThread ()
 	    // get stable copy of canvas into staging area
 	    pthread_mutex_lock (&fb_lock);
 		bool is_new = fb_dirty || pr_flag;
+                int pr_staged = 0;
 		if (is_new) {
                     setStagingArea();
 		    fb_dirty = false;
-                    pr_flag = 0;
+                    if (pr_flag) {
+                        pr_flag = 0;
+                        pr_staged = ++pr_seq;
+                    }
                     work = true;
 		}
 	    pthread_mutex_unlock (&fb_lock);
@@ -1510,61 +3103,86 @@ void Adafruit_RA8875::fbThread ()
             clock_gettime (CLOCK_MONOTONIC_RAW, &ts);
             int ms_idle = (ts.tv_sec - mouse_ts.tv_sec)*1000 + (ts.tv_nsec - mouse_ts.tv_nsec)/1000000;
 
-            // copy fb_stage to hardware display if new or mouse moved
-            if (is_new || ms_idle < MOUSE_FADE) {
-
-                // copy to cursor layer
-                memcpy (fb_cursor, fb_stage, fb_nbytes);
-
-                // add cursor if moved
-                // N.B.: CAN NOT use the nice drawing tools because they use fb_canvas
-                if (ms_idle < MOUSE_FADE) {
-                    const uint32_t fgcolor = 0x000000;
-                    const uint32_t bgcolor = 0xFF2222;
-                    // fill top half
-                    for (uint16_t r = 0; r < FB_CURSOR_SZ/2; r++)
-                        for (uint16_t c = r/2+1; c < 2*r-1; c++)
-                            setCursorIfVis (r, c, bgcolor);
-                    // fill bottom half
-                    for (uint16_t r = FB_CURSOR_SZ/2; r < FB_CURSOR_SZ; r++)
-                        for (uint16_t c = r/2+1; c < 3*FB_CURSOR_SZ/2-r-1; c++)
-                            setCursorIfVis (r, c, bgcolor);
-                    // draw border
-                    for (uint16_t i = 0; i < FB_CURSOR_SZ/2; i++) {
-                        setCursorIfVis(i, 2*i, fgcolor);
-                        setCursorIfVis(i, 2*i+1, fgcolor);
-                        setCursorIfVis(2*i, i, fgcolor);
-                        setCursorIfVis(2*i+1, i, fgcolor);
-                        setCursorIfVis(FB_CURSOR_SZ-i-1, i+FB_CURSOR_SZ/2, fgcolor);
-                    }
+            // draw into the hidden page if flipping, else directly into the visible page
+            int pg = fb_flip ? 1-fb_page : 0;
+            uint32_t *fb_page0 = fb_fb + pg*fb_si.yres*fb_si.xres;
+
+            // find where the cursor belongs now and whether that differs from what is showing
+            bool cursor_on = ms_idle < MOUSE_FADE;
+            FBRect cbox;
+            cbox.x = mouse_x - FB_X0;
+            cbox.y = mouse_y - FB_Y0;
+            cbox.w = FB_XRES - cbox.x < FB_CURSOR_SZ ? FB_XRES - cbox.x : FB_CURSOR_SZ;
+            cbox.h = FB_YRES - cbox.y < FB_CURSOR_SZ ? FB_YRES - cbox.y : FB_CURSOR_SZ;
+            int shown = fb_flip ? fb_page : 0;
+            bool cursor_changed = cursor_on != fb_cursor_on[shown]
+                        || (cursor_on && (cbox.x != fb_cursor_box[shown].x || cbox.y != fb_cursor_box[shown].y));
+
+            uint32_t show_t0 = fbMicros();
+            if (is_new || cursor_changed) {
+
+                // the hidden page also missed whatever was shown on the previous frame.
+                // the other page will then miss only what is staged now, nothing if just the cursor moved.
+                if (fb_flip) {
+                    for (int i = 0; i < fb_nprects; i++)
+                        copyStageRect (fb_page0, fb_stage, fb_prects[i]);
+                    memcpy (fb_prects, fb_srects, fb_nsrects*sizeof(FBRect));
+                    fb_nprects = fb_nsrects;
                 }
 
-                // wait for vertical sync TODO
-                // int zero = 0;
-                // if (ioctl(fb_fd, FBIO_WAITFORVSYNC, &zero) < 0)
-                    // printf ("FBIO_WAITFORVSYNC: %s\n", strerror(errno));
-
-                // black top border
-                const uint32_t fb_rowbytes = fb_si.xres*fb_pixlen;
-                memset (fb_fb, 0, FB_Y0*fb_rowbytes);
-
-                // copy cursor area to screen, and blacken left and right borders
-                for (int y = 0; y < FB_YRES; y++) {
-                    uint32_t *fb_row0 = fb_fb+(FB_Y0+y)*fb_si.xres;
-                    memset (fb_row0, 0, FB_X0*fb_pixlen);                       // left border
-                    memcpy (fb_row0+FB_X0, fb_cursor+y*FB_XRES, FB_XRES*fb_pixlen);
-                    memset (fb_row0+FB_X0+FB_XRES, 0, FB_X0*fb_pixlen);         // right border
-                }
+                // copy just the staged regions to hardware, once
+                for (int i = 0; i < fb_nsrects; i++)
+                    copyStageRect (fb_page0, fb_stage, fb_srects[i]);
+                fb_nsrects = 0;
 
-                // black bottom border
-                memset (fb_fb+(FB_Y0+FB_YRES)*fb_si.xres, 0, FB_Y0*fb_rowbytes);
+                // fb_stage is the backing store for the cursor sprite: restore what was under it
+                // on this page then draw it again wherever it is now.
+                if (fb_cursor_on[pg])
+                    copyStageRect (fb_page0, fb_stage, fb_cursor_box[pg]);
+                if (cursor_on)
+                    drawCursor (fb_page0, cbox);
+                fb_cursor_on[pg] = cursor_on;
+                fb_cursor_box[pg] = cbox;
 
                 work = true;
             }
 
-	    // don't go crazy if nothing to do
-            if (!work)
-                usleep (20000);
+            // show the page just drawn
+            if (fb_flip && work) {
+                fb_si.yoffset = (1-fb_page)*fb_si.yres;
+                waitVSync();
+                if (ioctl (fb_fd, FBIOPAN_DISPLAY, &fb_si) < 0) {
+                    // driver changed its mind: copy into the visible page from now on, starting afresh
+                    printf ("FBIOPAN_DISPLAY: %s\n", strerror(errno));
+                    fb_flip = false;
+                    fb_si.yoffset = fb_page*fb_si.yres;
+                    fb_fb += fb_si.yoffset*fb_si.xres;
+                    FBRect all = {0, 0, FB_XRES, FB_YRES};
+                    copyStageRect (fb_fb, fb_stage, all);
+                    fb_cursor_on[0] = false;
+                } else
+                    fb_page = 1 - fb_page;
+            }
+
+            fb_show_us = fbMicros() - show_t0;
+
+            // let drawPR() know its region is now on the screen
+            if (pr_staged) {
+                pthread_mutex_lock (&fb_lock);
+                    pr_stage_us = fb_stage_us;
+                    pr_show_us = fb_show_us;
+                    pr_shown = pr_staged;
+                    pthread_cond_broadcast (&pr_cond);
+                pthread_mutex_unlock (&fb_lock);
+            }
+
+	    // sleep until more drawing or input, or until time for the cursor to fade
+            if (!work) {
+                int fade_ms = -1;
+                if (fb_cursor_on[fb_flip ? fb_page : 0])
+                    fade_ms = MOUSE_FADE - ms_idle > 1 ? MOUSE_FADE - ms_idle : 1;
+                waitFB (-1, fade_ms);
+            }
 	}
 }
 
@@ -13,8 +13,11 @@
 #ifdef _USE_X11
 
 #include <sys/time.h>
+#include <sys/ipc.h>
+#include <sys/shm.h>
 #include <X11/Xlib.h>
 #include <X11/Xutil.h>
+#include <X11/extensions/XShm.h>
 
 // simplest to just recreate the same fb structure
 struct fb_var_screeninfo {
@@ -148,24 +151,87 @@ class Adafruit_RA8875 {
 	    uint16_t color16);
 	void fillTriangle(int16_t x0, int16_t y0, int16_t x1, int16_t y1, int16_t x2, int16_t y2,
 	    uint16_t color16);
+	void fillPolygon (const int16_t x[], const int16_t y[], int n, uint16_t color16);
 
-	// special method to draw hi res earth pixel
+	// special method to draw hi res earth pixel, shaded for the sun given to setEarthSun()
 	void plotEarth (uint16_t x0, uint16_t y0, float lat0, float lng0,
-            float dlatr, float dlngr, float dlatd, float dlngd, float fract_day);
+            float dlatr, float dlngr, float dlatd, float dlngd);
+        void setEarthSun (float sslat, float sslng, float gl_cos, float gl_pow);
+
+        // off-screen layer in which other threads may draw the earth without locking, then shown at once
+        bool openMapLayer (uint16_t x, uint16_t y, uint16_t w, uint16_t h, bool fresh);
+        int mapLayerTiles (void);
+	bool plotEarthLayer (uint16_t x0, uint16_t y0, float lat0, float lng0,
+            float dlatr, float dlngr, float dlatd, float dlngd, uint8_t *mtiles);
+        void markMapLayer (const uint8_t *mtiles);
+        bool mapLayerStale (uint16_t x, uint16_t y);
+        void drawLayerPixel (int16_t x, int16_t y, uint16_t color16);
+        void showMapLayer (uint16_t x, uint16_t y, uint16_t w, uint16_t h);
 
         // methods to implement a protected rectangle drawn only with drawPR()
         void setPR (uint16_t x, uint16_t y, uint16_t w, uint16_t h);
         void drawPR(void);
+        void getPRTimes (uint32_t &stage_us, uint32_t &show_us);
         uint16_t pr_x, pr_y, pr_w, pr_h;
         volatile char pr_flag;
 	void setStagingArea(void);
 
+        // methods to perform many drawing operations while locking fb_lock only once
+        void beginBatch(void);
+        void endBatch(void);
+
+        // methods to draw symbols into a layer over the canvas, so they may be erased again without
+        // drawing whatever was beneath them. drawing on the canvas hides any overlay it covers.
+        void beginOverlay(void);
+        void endOverlay(void);
+        void eraseOverlay (int16_t x, int16_t y, int16_t w, int16_t h);
+
 	// real/app display size
 	int SCALESZ;
 
         // get next keyboard character
         char getChar(void);
 
+        // signature of the low level kernels that fill n pixels at dst with color32
+        typedef void (*FillSpanFunc)(uint32_t *dst, uint32_t color32, int n);
+
+        // tables to find the day weight of each earth texel, built by setEarthSun().
+        // cos of angle to the subsolar point is a[row] + b[row]*c[col], then w[] spans the grayline.
+        #define FB_SUN_N        256                             // steps across the grayline in w[]
+        typedef struct {
+            float *a, *b;                                       // per texel row, sin and cos(lat) products
+            float *c;                                           // per texel col, cos(sslng-lng)
+            float cos0, k;                                      // w[] index is (cos_t-cos0)*k
+            uint8_t w[FB_SUN_N+1];                              // day weight across the grayline
+        } EarthSun;
+
+        // the day and night earth textures and their mip chain, each level box filtered from the one
+        // before to half its size. where the map squeezes many texels into one sub-pixel, such as the
+        // azimuthal rim, sampling the level whose texels are about a sub-pixel in size avoids aliasing
+        // and keeps the fetches close together.
+        #define FB_EARTH_MIPS   5                               // levels, 0 is the full texture
+        typedef struct {
+            const uint16_t *day, *night;                        // h x w textures
+            int w, h;                                           // size in texels
+        } EarthMip;
+
+        // one row of earth sub-pixels for the low level kernels that draw them.
+        // texel coords are 16.16 fixed point, u,v in [0,u1) and [0,v1).
+        typedef struct {
+            const uint16_t *day, *night;                        // textures of one EarthMip
+            int w;                                              // texture width, texels
+            int32_t u1, v1;                                     // texture width and height, 16.16
+            int32_t u, du;                                      // texel column of first pixel and step
+            int32_t v, dv;                                      // texel row of first pixel and step
+            int wday;                                           // day weight 0 .. FB_EARTH_WMAX, or
+            const EarthSun *sun;                                //   -1 to find each from sun
+        } EarthSpan;
+        #define FB_EARTH_WMAX   32                              // wday for all day
+        #define FB_EARTH_LANES  4                               // max n for EarthSpanFunc
+
+        // signature of the low level kernels that draw n <= FB_EARTH_LANES earth pixels at dst
+        typedef void (*EarthSpanFunc)(uint32_t *dst, const EarthSpan &es, int n);
+
     protected:
 
 	// 0: normal 2: 180 degs
@@ -211,6 +277,13 @@ class Adafruit_RA8875 {
 	XImage *img;
 	Pixmap pixmap;
 
+	// fb_stage is shared with the X server if MIT-SHM is available, else img is sent over the socket
+	bool initShm (Visual *visual);
+	static int shmErrorHandler (Display *d, XErrorEvent *e);
+	static volatile bool shm_error;
+	XShmSegmentInfo shminfo;
+	bool use_shm;
+
 #endif // _USE_X11
 
 #ifdef _USE_FB0
@@ -229,7 +302,11 @@ class Adafruit_RA8875 {
         void findKeyboard(void);
         int kb_fd;
 
-        void setCursorIfVis (uint16_t row, uint16_t col, uint32_t color);
+        // cursor is a sprite drawn straight onto the hw page, fb_stage holds what is beneath it
+        void initCursor (void);
+        void setSpritePixel (uint16_t row, uint16_t col, uint32_t color);
+        #define FB_SPRITE_CLEAR 0xFF000000     // transparent sprite pixel
+        uint32_t *fb_sprite;
 
 	int fb_fd;
 	int FB_CURSOR_SZ;
@@ -237,7 +314,6 @@ class Adafruit_RA8875 {
 	#define FB_BPP_RQD 32
 	uint32_t *fb_fb;
         uint32_t fb_pixlen;
-	uint32_t *fb_cursor;
 
 #endif	// _USE_FB0
 
@@ -254,16 +330,126 @@ class Adafruit_RA8875 {
 	#define APP_HEIGHT 480
 	void fbThread ();
 	pthread_mutex_t fb_lock;
+
+	// fbThread sleeps in poll(2) until something is written to fb_wake, or input arrives.
+	// drawPR() waits on pr_cond until fbThread has shown the staging numbered pr_seq+1.
+	int fb_wake[2];                                         // self-pipe, read and write ends
+	void initWake (void);
+	void wakeFB (void);
+	void waitFB (int fd, int ms);
+	pthread_cond_t pr_cond;
+	int pr_seq;                                             // n PR stagings so far
+	int pr_shown;                                           // n PR stagings shown so far
+	uint32_t fb_stage_us, fb_show_us;                       // time to stage and show the last frame
+	uint32_t pr_stage_us, pr_show_us;                       // same for the last frame with the PR
+
+	// drawing methods lock fb_lock unless already held by beginBatch()
+	int fb_batch;
+	void lockFB(void)
+	{
+	    if (!fb_batch)
+		pthread_mutex_lock (&fb_lock);
+	}
+	void unlockFB(void)
+	{
+	    if (!fb_batch)
+		pthread_mutex_unlock (&fb_lock);
+	}
 	struct fb_var_screeninfo fb_si;
 	volatile bool fb_dirty;
 	uint32_t *fb_canvas;
 	uint32_t *fb_stage;
 	int fb_nbytes;
+
+	// damaged regions of fb_canvas are tracked as a bitmap of FB_DTILE x FB_DTILE tiles.
+	// setStagingArea() merges dirty tiles into at most FB_MAX_DRECTS rectangles then stages
+	// and shows only those, further split into at most 4 each to avoid the protected region.
+	#define FB_DTILE 32                                     // fb pixels on each side of a tile
+	#define FB_DTILES_X ((FB_XRES+FB_DTILE-1)/FB_DTILE)     // n tiles across
+	#define FB_DTILES_Y ((FB_YRES+FB_DTILE-1)/FB_DTILE)     // n tiles down
+	#define FB_MAX_DRECTS 64                                // max merged rectangles per frame
+	typedef struct {
+	    uint16_t x, y, w, h;                                // fb coords
+	} FBRect;
+	uint8_t fb_dtiles[FB_DTILES_Y][FB_DTILES_X];            // 1 if tile needs staging
+	FBRect fb_srects[4*FB_MAX_DRECTS];                      // rectangles staged this frame
+	int fb_nsrects;                                         // n used in fb_srects[]
+	void markDirty (int x0, int y0, int x1, int y1);
+	int collectDirtyRects (FBRect rects[]);
+	void addStageRect (int x, int y, int w, int h);
+
+	// symbols are drawn into fb_over while fb_over_depth > 0 and composited over fb_canvas as each
+	// row is staged, but only within tiles marked in fb_otiles.
+	#define FB_OVER_CLEAR 0xFF000000                        // fb_over pixel not drawn
+	uint32_t *fb_over;                                      // overlay, same size as fb_canvas
+	uint8_t fb_otiles[FB_DTILES_Y][FB_DTILES_X];            // 1 if tile may have overlay pixels
+	int fb_over_depth;                                      // n beginOverlay() not yet ended
+	void initOverlay (void);
+	void stageRow (int x, int y, int w);
+
+#ifdef _USE_FB0
+	// if the driver can pan a virtual fb twice the visible height we draw into the hidden
+	// page then flip to it, else we copy into the one visible page. the hidden page also
+	// needs the regions drawn on the previous frame so we remember those in fb_prects.
+	bool fb_flip;                                           // whether page flipping is available
+	int fb_page;                                            // page now showing, 0 or 1
+	bool fb_vsync;                                          // whether FBIO_WAITFORVSYNC works
+	FBRect fb_prects[4*FB_MAX_DRECTS];                      // regions staged on the previous frame
+	int fb_nprects;                                         // n used in fb_prects[]
+	void initFlip (void);
+	void waitVSync (void);
+	void copyStageRect (uint32_t *page, const uint32_t *src, const FBRect &r);
+	bool fb_cursor_on[2];                                   // whether cursor is drawn on each page
+	FBRect fb_cursor_box[2];                                // where cursor is drawn on each page
+	void drawCursor (uint32_t *page, const FBRect &box);
+#endif	// _USE_FB0
+
 	void plotLineLow(int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint32_t color32);
 	void plotLineHigh(int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint32_t color32);
 	void plotLine(int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint32_t color32);
 	void plot32 (int16_t x, int16_t y, uint32_t color32);
+	void fillSpan (int x, int y, int w, uint32_t color32);
+	void fillRingRow (int x0, int y, int ho, int hi, uint32_t color32);
+	#define FB_MAX_POLY 16                                  // max fillPolygon() vertices
+	int polyCeil (int64_t num, int64_t den);
+	void polyRun (int32_t xa, int32_t ya, int32_t xb, int32_t yb, int py, int &xl, int &xr);
+	FillSpanFunc fill_span;
+	const char *fill_span_name;
+	EarthSpanFunc earth_span;
+	const char *earth_span_name;
+	EarthSun fb_sun[FB_EARTH_MIPS];                         // built by setEarthSun(), one per fb_mip[]
+	float fb_sun_lat, fb_sun_lng;                           // subsolar point fb_sun was built for
+	double fb_sun_motion;                                   // total arc the sun has moved, rads
+	void plotEarthTo (uint32_t *dst, uint16_t x0, uint16_t y0, float lat0, float lng0,
+            float dlatr, float dlngr, float dlatd, float dlngd, float &slack);
+	int earthBlockShade (int l, int32_t u, int32_t v, float dlatr, float dlngr, float dlatd, float dlngd,
+            float &slack);
+	#define FB_MAP_CLEAR 0xFF000000                         // fb_map pixel not drawn
+	uint32_t *fb_map;                                       // malloced map layer, else NULL
+	double *fb_map_exp;                                     // malloced fb_sun_motion each app pixel expires
+	uint8_t fb_mtiles[FB_DTILES_Y][FB_DTILES_X];            // 1 if tile changed since showMapLayer()
 	void plotChar (char c);
+	void plotString (const char *s, int n);
+
+	// each glyph is rasterised once into horizontal runs of set bits, cached per font.
+	// fonts are already at fb resolution so nothing here depends on SCALESZ.
+	#define FB_MAX_GFONTS 8                                 // max fonts cached at once
+	typedef struct {
+	    int16_t x, y, w;                                    // run offset from glyph UL, length
+	} FBGlyphRun;
+	typedef struct {
+	    FBGlyphRun *runs;                                   // malloced runs, or NULL
+	    int nruns;                                          // n runs[], -1 until built
+	} FBGlyph;
+	typedef struct {
+	    const GFXfont *font;                                // font these glyphs belong to
+	    FBGlyph *glyphs;                                    // one per font->first .. last
+	} FBGlyphFont;
+	FBGlyphFont fb_gfonts[FB_MAX_GFONTS];                   // cached fonts
+	int fb_ngfonts;                                         // n fonts ever cached
+	FBGlyphFont *fb_gfont;                                  // font last used
+	FBGlyph *getGlyph (const GFXfont *font, int i);
+	void plotGlyph (char ch);
 	uint32_t text_color32;
 	uint16_t cursor_x, cursor_y;
 	uint16_t read_x, read_y;
@@ -272,9 +458,13 @@ class Adafruit_RA8875 {
 	int FB_X0;
 	int FB_Y0;
 
-	// big earth maps
-	static const uint16_t DEARTH_BIG[EARTH_BIG_H][EARTH_BIG_W];
-	static const uint16_t NEARTH_BIG[EARTH_BIG_H][EARTH_BIG_W];
+	// big earth maps are EARTH_BIG_H x EARTH_BIG_W RGB565 files mapped read-only, paged in on demand.
+	// the coarser levels are built along with the first sun tables.
+	EarthMip fb_mip[FB_EARTH_MIPS];                         // level 0 is mapped, the rest malloced
+	int fb_nmips;                                           // n levels ready
+	void initEarthMaps (void);
+	void initEarthMips (void);
+	const uint16_t *mmapEarthMap (const char *name);
 
 };
 
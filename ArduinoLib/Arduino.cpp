@@ -26,6 +26,21 @@ uint32_t millis(void)
 	return (dt);
 }
 
+/* return microseconds since first call, wrapping after about 71 minutes as on the ESP
+ */
+uint32_t micros(void)
+{
+	static struct timespec t0;
+
+	struct timespec t;
+	clock_gettime (CLOCK_MONOTONIC_RAW, &t);
+
+	if (t0.tv_sec == 0 && t0.tv_nsec == 0)
+	    t0 = t;
+
+	return ((uint32_t)((t.tv_sec - t0.tv_sec)*1000000LL + (t.tv_nsec - t0.tv_nsec)/1000));
+}
+
 void delay (uint32_t ms)
 {
 	usleep (ms*1000);
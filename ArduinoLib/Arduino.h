@@ -47,6 +47,7 @@
 #define	pgm_read_float(a)	(*(a))
 
 extern uint32_t millis(void);
+extern uint32_t micros(void);
 extern int random(int max);
 extern void delay (uint32_t ms);
 extern uint16_t analogRead(int pin);
@@ -416,6 +416,9 @@ void loop()
     // update sat pass (this is just the pass; the path is recomputed before each map sweep)
     updateSatPass();
 
+    // keep the pass timeline of all catalog sats fresh
+    updateSatCat();
+
     // update NCFDX beacons, don't erase if holding path
     updateBeacons(!waiting4DXPath(), false, false);
 
@@ -938,17 +941,20 @@ static void eraseDXPath()
     if (!n_gpath)
         return;
 
+    tft.beginBatch();
+
     // erase the prefix box
     for (uint16_t dy = 0; dy < prefix_b.h; dy++)
-        for (uint16_t dx = 0; dx < prefix_b.w; dx++)
-            drawMapCoord (prefix_b.x + dx, prefix_b.y + dy);
+        eraseMapSpan (prefix_b.x, prefix_b.y + dy, prefix_b.w);
 
     // erase the great path
     for (uint16_t i = 0; i < n_gpath; i++) {
-	drawMapCoord (gpath[i]);			// draws x and x+1, y
-	drawMapCoord (gpath[i].x, gpath[i].y+1);	//        "       , y+1
+	eraseMapSpan (gpath[i].x, gpath[i].y, 1);	// ESP draws x and x+1, y
+	eraseMapSpan (gpath[i].x, gpath[i].y+1, 1);	//          "          , y+1
     }
 
+    tft.endBatch();
+
     // mark no longer active
     setDXPathInvalid();
 }
@@ -992,6 +998,7 @@ static void drawDXPath ()
     float ca, B;
     SCoord s;
     n_gpath = 0;
+    tft.beginOverlay();
     for (float b = 0; b < 2*M_PIF; b += 2*M_PIF/MAX_GPATH) {
 	solveSphere (bear, b, sdelat, cdelat, &ca, &B);
 	ll2s (asinf(ca), myfmodf(de_ll.lng+B+5*M_PIF,2*M_PIF)-M_PIF, s, 1);
@@ -1010,6 +1017,7 @@ static void drawDXPath ()
                 tft.drawPixel (s.x, s.y, c);
 	}
     }
+    tft.endOverlay();
 
     // reduce to actual number of points used
     Serial.printf ("n_gpath %u -> %u\n", MAX_GPATH, n_gpath);
@@ -1050,9 +1058,11 @@ void drawDXMarker (bool force)
     if (!force && !overMap(dx_c.s))
 	return;
 
+    tft.beginOverlay();
     tft.fillCircle (dx_c.s.x, dx_c.s.y, DX_R, DX_COLOR);
     tft.drawCircle (dx_c.s.x, dx_c.s.y, DX_R, RA8875_BLACK);
     tft.fillCircle (dx_c.s.x, dx_c.s.y, 2, RA8875_BLACK);
+    tft.endOverlay();
 }
 
 /* return the bounding box of the given string in the current font.
@@ -1709,10 +1719,12 @@ void drawMapTag (char *tag, uint16_t x, uint16_t y, uint16_t r, SBox &box)
     }
 
     // draw
+    tft.beginOverlay();
     tft.fillRect (box.x, box.y, box.w, box.h, RA8875_BLACK);
     tft.setCursor (box.x+2, box.y + 1);
     tft.setTextColor (RA8875_WHITE);
     tft.print(tag);
+    tft.endOverlay();
 }
 
 /* return whether screen is currently locked
@@ -1747,16 +1759,26 @@ bool inCircle (const SCoord &s, const SCircle &c)
  */
 void eraseSCircle (const SCircle &c)
 {
-    // scan a circle of radius r+1/2 to include whole pixel.
-    // radius (r+1/2)^2 = r^2 + r + 1/4 so we use 2x everywhere to avoid floats
-    uint16_t radius2 = 4*c.r*(c.r + 1) + 1;
-    for (int16_t dy = -2*c.r; dy <= 2*c.r; dy += 2) {
-        for (int16_t dx = -2*c.r; dx <= 2*c.r; dx += 2) {
-            int16_t xy2 = dx*dx + dy*dy;
-            if (xy2 <= radius2)
-                drawMapCoord (c.s.x+dx/2, c.s.y+dy/2);
-        }
+    // restore a circle of radius r+1/2 to include whole pixel.
+    // radius (r+1/2)^2 = r^2 + r + 1/4 so we use 2x everywhere to avoid floats.
+    // walk down from the center row shrinking the half-width as needed and restore the rows above and below.
+    // desktops draw the circle at full resolution which can reach into one more pixel left and above.
+#if defined(_USE_DESKTOP)
+    int16_t r = c.r + 1;
+#else
+    int16_t r = c.r;
+#endif
+    int32_t radius2 = 4*r*(r + 1) + 1;
+    int16_t hw = r;
+    tft.beginBatch();
+    for (int16_t dy = 0; dy <= r; dy++) {
+        while (4*(hw*hw + dy*dy) > radius2)
+            hw--;
+        eraseMapSpan (c.s.x-hw, c.s.y+dy, 2*hw+1);
+        if (dy > 0)
+            eraseMapSpan (c.s.x-hw, c.s.y-dy, 2*hw+1);
     }
+    tft.endBatch();
 }
 
 /* erase entire screen
@@ -397,6 +397,24 @@ extern SCircle moon_c;
 
 extern uint32_t max_wd_dt;
 
+// phases of each map sweep timed for getMapPerf()
+typedef enum {
+    MP_SWEEP,                                   // whole sweep, start through showing the map
+    MP_CIRCUMSTANCES,                           // updateCircumstances() at the start
+    MP_RENDER,                                  // drawing map pixels
+    MP_SYMBOLS,                                 // drawing symbols and sat path
+    MP_STAGE,                                   // staging the map frame for display, desktop only
+    MP_PRESENT,                                 // sending the staged map frame to the display, desktop only
+    MP_N
+} MapPerfPhase;
+typedef struct {
+    uint32_t n;                                 // sweeps ever timed
+    uint32_t p50, p90, max;                     // of the most recent MP_NS sweeps, usecs
+} MapPerfStat;
+#define MP_NS   32                              // recent sweeps kept for each phase
+extern uint8_t log_map_perf;
+extern void getMapPerf (MapPerfStat stats[MP_N]);
+
 extern void drawMoreEarth (void);
 extern void eraseDEMarker (void);
 extern void eraseDEAPMarker (void);
@@ -409,6 +427,8 @@ extern void initEarthMap (void);
 extern void antipode (LatLong &to, const LatLong &from);
 extern void drawMapCoord (const SCoord &s);
 extern void drawMapCoord (uint16_t x, uint16_t y);
+extern void eraseMapSpan (uint16_t x, uint16_t y, uint16_t w);
+extern void occupyMapBox (const SBox &b);
 extern void drawSun (void);
 extern void drawMoon (void);
 extern void drawDXInfo (void);
@@ -451,6 +471,16 @@ extern void initBME280Retry(void);
  *
  */
 
+// everything findSatPass() learns about a pass
+typedef struct {
+    DateTime rise_time, set_time;       // next rise and set, set < rise iff pass is in progress
+    DateTime max_time;                  // time of max el of the pass in progress else the next pass
+    float rise_az, set_az;              // az at rise and set, degrees, if valid
+    float max_el, max_az;               // max el and its az, degrees, if max_ok
+    bool rise_ok, set_ok, max_ok;       // whether the above are valid
+    bool ever_up, ever_down;            // whether ever above or below SAT_MIN_EL during the search
+} SatPass;
+
 extern void updateSatPath(void);
 extern void updateSatPass(void);
 extern bool querySatSelection(bool timeout);
@@ -466,12 +496,18 @@ extern bool setSatFromTLE (const char *name, const char *t1, const char *t2);
 extern bool initSatSelection(void);
 extern bool getSatAzElNow (char *name, float *azp, float *elp, float *razp, float *sazp,
         float *rdtp, float *sdtp);
+extern bool getSatMaxEl (float *elp, float *azp, float *mdtp);
+extern int findSatPass (Satellite *sp, const Observer *op, const DateTime &t0, float max_s, SatPass &pass);
+extern bool tleHasValidChecksum (const char *line);
+extern const char sat_get_all[];
 extern bool isNewPass(void);
 extern bool isSatMoon(void);
+extern bool isSatDefined(void);
 
 #define SAT_NOAZ        (-999)  // error flag
 #define SAT_MIN_EL      1.0F    // rise elevation
 #define TLE_LINEL       70      // including EOS
+#define TLE_REFRESH     (3600*6) // freshen TLEs this often, seconds
 
 
 
@@ -567,6 +603,8 @@ extern float myatof (const char *s);
 extern void updateBeacons (bool erase_too, bool immediate, bool force);
 extern void updateBeaconScreenLocations(void);
 extern bool overAnyBeacon (const SCoord &s);
+extern bool beaconsMoved (void);
+extern void occupyBeacons (void);
 extern void drawBeaconBox();
 
 typedef uint8_t BeaconID;
@@ -773,6 +811,25 @@ extern SBox santa_b;
 
 
 
+/*********************************************************************************************
+ *
+ * satcat.cpp
+ *
+ */
+
+// one pass of one catalog satellite
+typedef struct {
+    char name[NV_SATNAME_LEN];          // sat name
+    time_t rise, set;                   // nowWO() times; rise is when found if already up
+    float rise_az, set_az;              // degrees, SAT_NOAZ if up at start or end of the search
+    float max_el;                       // degrees
+} SatCatPass;
+
+extern void updateSatCat(void);
+extern int getSatCatPasses (SatCatPass *pp, int max);
+extern int nSatCat(void);
+
+
 /*********************************************************************************************
  *
  * selectFont.cpp
@@ -810,6 +867,21 @@ extern void solveSphere (float A, float b, float cc, float sc, float *cap, float
 
 
 
+/*********************************************************************************************
+ *
+ * tlecache.cpp
+ *
+ */
+
+extern bool getCachedTLE (const char *name, char stored_name[NV_SATNAME_LEN], char t1[TLE_LINEL],
+        char t2[TLE_LINEL], time_t *fetched, time_t *epoch);
+extern void putCachedTLE (const char *name, const char *t1, const char *t2);
+extern bool freshenTLECache(void);
+extern bool getCachedTLEn (int i, char name[NV_SATNAME_LEN], char t1[TLE_LINEL], char t2[TLE_LINEL]);
+extern time_t cachedTLEsFetched(void);
+
+
+
 /*********************************************************************************************
  *
  * touch.cpp
@@ -894,7 +966,9 @@ extern bool getTCPLine (WiFiClient &client, char line[], uint16_t line_len, uint
 extern void sendUserAgent (WiFiClient &client);
 extern bool wifiOk(void);
 extern void httpGET (WiFiClient &client, const char *server, const char *page);
+extern void httpGETIMS (WiFiClient &client, const char *server, const char *page, time_t ims);
 extern bool httpSkipHeader (WiFiClient &client);
+extern bool httpSkipHeader (WiFiClient &client, int *status);
 extern void FWIFIPR (WiFiClient &client, const __FlashStringHelper *str);
 extern void FWIFIPRLN (WiFiClient &client, const __FlashStringHelper *str);
 
@@ -422,6 +422,86 @@ Satellite::predict(const DateTime &dt)
     V[2] = VEL[2] ;
 }
 
+/* same as predict() but for n times at once, leaving geocentric S and V for each in ss.
+ * the per-element constants are found once for the whole batch, each Kepler solve starts
+ * from the previous step's E-M (which is small and smooth) so closely spaced steps converge
+ * in one or two iterations, and the RAAN and GHA rotations about z are folded into one.
+ * N.B. the single-time members SAT, VEL, S, V and RS are not changed.
+ */
+void
+Satellite::predictMany(const DateTime *dt, int n, SatStates &ss)
+{
+    // GHA at epoch is thousands of radians; reduce it once here so the float sum each step keeps its precision
+    double TEG = DE - fnday(YG, 1, 0) + TE ;
+    float GHAE = fmod(RADIANS(G0) + TEG * WE, 2*M_PI) ;
+
+    float CI = cosf(IN) ;
+    float SI = sinf(IN) ;
+
+    float EMM = 0 ;		// E-M of previous step
+
+    for (int i = 0; i < n; i++) {
+
+	float T = (float) (dt[i].DN - DE) + (dt[i].TN-TE) ;
+	float DT = DC * T / 2.F ;
+	float KD = 1.F + 4.F * DT ;
+	float KDP = 1.F - 7.F * DT ;
+
+	float M = MA + MM * T * (1.F - 3.F * DT) ;
+	float DR = (long) (M / (2.F * M_PI)) ;
+	M -= DR * 2.F * M_PI ;
+	float EA = M + EMM ;
+
+	float DNOM, C_EA, S_EA ;
+
+	for (;;) {
+	    C_EA = cosf(EA) ;
+	    S_EA = sinf(EA) ;
+	    DNOM = 1.F - EC * C_EA ;
+	    float D = (EA-EC*S_EA-M)/DNOM ;
+	    EA -= D ;
+	    if (fabs(D) < 1e-5)
+		break ;
+	}
+	EMM = EA - M ;
+
+	float A = A_0 * KD ;
+	float B = B_0 * KD ;
+
+	float Sx = A * (C_EA - EC) ;
+	float Sy = B * S_EA ;
+
+	float AP = WP + WD * T * KDP ;
+	float CW = cosf(AP) ;
+	float SW = sinf(AP) ;
+
+	// RAAN then -GHA about the same axis is one rotation by their sum
+
+	float L = RA + QD * T * KDP - (GHAE + WE * T) ;
+	float CL = cosf(L) ;
+	float SL = sinf(L) ;
+
+	float X0 =  CW * CL - SW * CI * SL ;
+	float X1 = -SW * CL - CW * CI * SL ;
+	float Y0 =  CW * SL + SW * CI * CL ;
+	float Y1 = -SW * SL + CW * CI * CL ;
+	float Z0 =  SW * SI ;
+	float Z1 =  CW * SI ;
+
+	ss.S[0][i] = Sx * X0 + Sy * X1 ;
+	ss.S[1][i] = Sx * Y0 + Sy * Y1 ;
+	ss.S[2][i] = Sx * Z0 + Sy * Z1 ;
+
+	if (ss.V[0]) {
+	    float Vx = -A * S_EA / DNOM * N0 ;
+	    float Vy =  B * C_EA / DNOM * N0 ;
+	    ss.V[0][i] = Vx * X0 + Vy * X1 ;
+	    ss.V[1][i] = Vx * Y0 + Vy * Y1 ;
+	    ss.V[2][i] = Vx * Z0 + Vy * Z1 ;
+	}
+    }
+}
+
 /* find local apparent circumstances
  */
 void
@@ -460,6 +540,54 @@ Satellite::geo(float &lat, float &lng)
     lng = atan2f(S[1],S[0]);
 }
 
+/* topo() for each of n states from predictMany().
+ * range and range_rate may be NULL if not wanted; range_rate requires ss.V.
+ */
+void
+Satellite::topoMany(const Observer *obs, const SatStates &ss, int n,
+float *alt, float *az, float *range, float *range_rate)
+{
+    for (int i = 0; i < n; i++) {
+	Vec3 R ;
+	R[0] = ss.S[0][i] - obs->O[0] ;
+	R[1] = ss.S[1][i] - obs->O[1] ;
+	R[2] = ss.S[2][i] - obs->O[2] ;
+	float r = sqrtf(R[0]*R[0]+R[1]*R[1]+R[2]*R[2]) ;
+	R[0] /= r ;
+	R[1] /= r ;
+	R[2] /= r ;
+
+	if (range)
+	    range[i] = r ;
+	if (range_rate)
+	    range_rate[i] = 1000*((ss.V[0][i]-obs->V[0])*R[0] + (ss.V[1][i]-obs->V[1])*R[1]
+	    			+ ss.V[2][i]*R[2]);	// m/s
+
+	float up = R[0] * obs->U[0] + R[1] * obs->U[1] + R[2] * obs->U[2] ;
+	float east = R[0] * obs->E[0] + R[1] * obs->E[1] + R[2] * obs->E[2] ;
+	float north = R[0] * obs->N[0] + R[1] * obs->N[1] + R[2] * obs->N[2] ;
+
+	float a = DEGREES(atan2f(east, north)) ;
+	if (a < 0) a += 360.F ;
+	az[i] = a ;
+
+	float h = DEGREES(asinf(up)) ;
+	h += (1000.0F/1010.0F)*(283.0F/(273.0F+10.0F))*1.02F/tanf(RADIANS(h + 10.3F/(h+5.11)))/60.0F;
+	alt[i] = h ;
+    }
+}
+
+// geo() for each of n states from predictMany()
+void
+Satellite::geoMany(const SatStates &ss, int n, float *lat, float *lng)
+{
+    for (int i = 0; i < n; i++) {
+	float r = sqrt(ss.S[0][i]*ss.S[0][i] + ss.S[1][i]*ss.S[1][i]);
+	lat[i] = atan2(ss.S[2][i],r);
+	lng[i] = atan2f(ss.S[1][i],ss.S[0][i]);
+    }
+}
+
 // celestial coords
 void
 Satellite::celest (float &lat, float &lng)
@@ -98,6 +98,16 @@ public:
 
 //----------------------------------------------------------------------
 
+// results of Satellite::predictMany() as separate arrays, one element per time step.
+// caller supplies the storage; V may be NULL if velocities are not wanted.
+
+typedef struct {
+    float *S[3] ;		// geocentric position, km
+    float *V[3] ;		// geocentric velocity, km/s
+} SatStates ;
+
+//----------------------------------------------------------------------
+
 class Satellite { 
   	long N ;
 	long YE ;	
@@ -132,9 +142,13 @@ public:
 	~Satellite() ;
         void tle(const char *l1, const char *l2) ;
         void predict(const DateTime &dt) ;
+        void predictMany(const DateTime *dt, int n, SatStates &ss) ;
 	bool eclipsed(Sun *sp);
 	void topo(const Observer *obs, float &alt, float &az, float &range, float &range_rate);
 	void geo(float &lat, float &lng);
+	static void topoMany(const Observer *obs, const SatStates &ss, int n,
+		float *alt, float *az, float *range, float *range_rate);
+	static void geoMany(const SatStates &ss, int n, float *lat, float *lng);
         void celest (float &lat, float &lng);
 	float period (void);
 	float viewingRadius(float alt);
@@ -0,0 +1,43 @@
+/* helpers shared by the benchmarks.
+ */
+
+#ifndef _BENCH_H
+#define _BENCH_H
+
+#include <stdint.h>
+#include <time.h>
+
+/* return a monotonic time in seconds
+ */
+static inline double benchNow (void)
+{
+        struct timespec ts;
+        clock_gettime (CLOCK_MONOTONIC, &ts);
+        return (ts.tv_sec + ts.tv_nsec*1e-9);
+}
+
+/* return the next of a repeatable sequence of pseudo random numbers 0 .. 2^31-1
+ */
+static inline uint32_t benchRand (void)
+{
+        static uint32_t seed = 1;
+        seed = seed*1103515245 + 12345;
+        return (seed >> 1);
+}
+
+/* return the best of reps calls of f(arg), in seconds
+ */
+static inline double benchBest (int reps, void (*f)(void *arg), void *arg)
+{
+        double best = 1e9;
+        for (int r = 0; r < reps; r++) {
+            double t0 = benchNow();
+            (*f)(arg);
+            double dt = benchNow() - t0;
+            if (dt < best)
+                best = dt;
+        }
+        return (best);
+}
+
+#endif // _BENCH_H
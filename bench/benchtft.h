@@ -0,0 +1,34 @@
+/* set up a display-less tft for the benchmarks that draw through Adafruit_RA8875.
+ * include after ../ArduinoLib/Adafruit_RA8875.cpp compiled with private and protected as public.
+ */
+
+#ifndef _BENCHTFT_H
+#define _BENCHTFT_H
+
+#include "bench.h"
+
+// as the application defines it
+Adafruit_RA8875 tft(0, 0);
+
+/* give tft the canvas, overlay and lock begin() would, without opening any display.
+ * N.B. nothing shows the canvas so fb_dtiles only ever accumulates.
+ */
+static void benchInitTFT (void)
+{
+        tft.SCALESZ = FB_XRES/APP_WIDTH;
+        tft.fb_canvas = (uint32_t *) calloc (FB_XRES*FB_YRES, sizeof(uint32_t));
+        if (!tft.fb_canvas) {
+            printf ("No memory for canvas\n");
+            exit(1);
+        }
+        tft.initOverlay();
+        memset (tft.fb_dtiles, 0, sizeof(tft.fb_dtiles));
+        tft.fb_dirty = false;
+
+        pthread_mutexattr_t fb_attr;
+        pthread_mutexattr_init (&fb_attr);
+        pthread_mutexattr_settype (&fb_attr, PTHREAD_MUTEX_RECURSIVE);
+        pthread_mutex_init (&tft.fb_lock, &fb_attr);
+}
+
+#endif // _BENCHTFT_H
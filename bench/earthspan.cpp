@@ -0,0 +1,200 @@
+/* check each earth span kernel against earthSpanScalar() then time them.
+ *
+ * random spans over noise textures cover all day, all night, a fixed blend and per pixel sun shading,
+ * with texel steps in both directions that wrap at, and land exactly on, the texture edges. every
+ * kernel built for this host must draw the same pixels as the scalar kernel and nothing beyond n.
+ * exits 1 if not.
+ */
+
+#include "../ArduinoLib/Adafruit_RA8875.cpp"
+#include "bench.h"
+
+#define TEX_W           660                             // texture size, as EARTH_BIG at 800x480
+#define TEX_H           330
+#define N_CHECK         500000                          // random spans to check
+#define N_TIME          4096                            // spans per timing pass
+#define GUARD           0xDEADBEEF                      // fills dst beyond n
+
+typedef struct {
+        const char *name;
+        Adafruit_RA8875::EarthSpanFunc f;
+} Kernel;
+
+static Kernel kernels[4];
+static int n_kernels;
+
+static uint16_t day[TEX_W*TEX_H], night[TEX_W*TEX_H];
+static Adafruit_RA8875::EarthSun sun;
+static float sun_a[TEX_H], sun_b[TEX_H], sun_c[TEX_W];
+
+/* collect each kernel this host can run, scalar first.
+ */
+static void findKernels (void)
+{
+        kernels[n_kernels++] = (Kernel){"scalar", earthSpanScalar};
+#if defined(_FILL_X86)
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports ("sse4.1"))
+            kernels[n_kernels++] = (Kernel){"SSE4.1", earthSpanSSE41};
+#endif
+#if defined(_FILL_NEON)
+        kernels[n_kernels++] = (Kernel){"NEON", earthSpanNEON};
+#endif
+}
+
+/* fill the textures with noise and build the sun tables as setEarthSun() does.
+ */
+static void initEarth (void)
+{
+        for (int i = 0; i < TEX_W*TEX_H; i++) {
+            day[i] = benchRand();
+            night[i] = benchRand();
+        }
+
+        float sslat = 20*M_PI/180, sslng = 30*M_PI/180;
+        float ss = sinf (sslat), cs = cosf (sslat);
+        for (int ey = 0; ey < TEX_H; ey++) {
+            float lat = (90.0F - 180.0F*ey/TEX_H)*(float)M_PI/180;
+            sun_a[ey] = ss*sinf(lat);
+            sun_b[ey] = cs*cosf(lat);
+        }
+        for (int ex = 0; ex < TEX_W; ex++) {
+            float lng = (360.0F*ex/TEX_W - 180.0F)*(float)M_PI/180;
+            sun_c[ex] = cosf (sslng - lng);
+        }
+        sun.a = sun_a;
+        sun.b = sun_b;
+        sun.c = sun_c;
+        sun.cos0 = -0.21F;
+        sun.k = FB_SUN_N/0.21F;
+        for (int i = 0; i <= FB_SUN_N; i++)
+            sun.w[i] = (int)((1 - powf (1 - (float)i/FB_SUN_N, 0.75F))*FB_EARTH_WMAX + 0.5F);
+}
+
+/* return a random span with the given day weight.
+ * N.B. steps stay within what plotEarthTo() uses, less than a texture size over FB_EARTH_LANES.
+ */
+static Adafruit_RA8875::EarthSpan randomSpan (int wday)
+{
+        Adafruit_RA8875::EarthSpan es;
+        es.day = day;
+        es.night = night;
+        es.w = TEX_W;
+        es.u1 = TEX_W << 16;
+        es.v1 = TEX_H << 16;
+        es.u = benchRand() % es.u1;
+        es.v = benchRand() % es.v1;
+        es.du = (int32_t)(benchRand() % (8 << 16)) - (4 << 16);
+        es.dv = (int32_t)(benchRand() % (8 << 16)) - (4 << 16);
+        es.wday = wday;
+        es.sun = &sun;
+
+        // sometimes land a later pixel exactly on the far edge, where it must wrap to 0
+        if (benchRand() % 4 == 0) {
+            es.du = (1 + benchRand() % 3) << 16;
+            es.u = es.u1 - es.du*(1 + benchRand() % (FB_EARTH_LANES-1));
+        }
+        if (benchRand() % 4 == 0) {
+            es.dv = (1 + benchRand() % 3) << 16;
+            es.v = es.v1 - es.dv*(1 + benchRand() % (FB_EARTH_LANES-1));
+        }
+
+        return (es);
+}
+
+/* return a day weight covering each case the kernels treat differently
+ */
+static int randomWday (int i)
+{
+        switch (i % 4) {
+        case 0:  return (0);
+        case 1:  return (FB_EARTH_WMAX);
+        case 2:  return (1 + benchRand() % (FB_EARTH_WMAX-1));
+        default: return (-1);
+        }
+}
+
+/* compare kernel k with scalar over N_CHECK random spans, return number that differ.
+ */
+static int checkKernel (const Kernel &k)
+{
+        int n_bad = 0;
+
+        for (int i = 0; i < N_CHECK; i++) {
+            Adafruit_RA8875::EarthSpan es = randomSpan (randomWday (i));
+            int n = 1 + benchRand() % FB_EARTH_LANES;
+            uint32_t want[2*FB_EARTH_LANES], got[2*FB_EARTH_LANES];
+            for (int j = 0; j < 2*FB_EARTH_LANES; j++)
+                want[j] = got[j] = GUARD;
+            earthSpanScalar (want, es, n);
+            (*k.f) (got, es, n);
+            if (memcmp (want, got, sizeof(want))) {
+                if (n_bad++ < 5)
+                    printf ("  %s differs: n %d wday %d u %d du %d v %d dv %d\n", k.name, n, es.wday,
+                                    es.u, es.du, es.v, es.dv);
+            }
+        }
+
+        return (n_bad);
+}
+
+// one timing pass: N_TIME spans of FB_EARTH_LANES pixels
+typedef struct {
+        Adafruit_RA8875::EarthSpanFunc f;
+        Adafruit_RA8875::EarthSpan *spans;
+        uint32_t *dst;
+} TimePass;
+
+static void timePass (void *arg)
+{
+        TimePass *tp = (TimePass *) arg;
+        for (int i = 0; i < N_TIME; i++)
+            (*tp->f) (&tp->dst[i*FB_EARTH_LANES], tp->spans[i], FB_EARTH_LANES);
+}
+
+int main (int ac, char *av[])
+{
+        (void) ac;
+        (void) av;
+
+        findKernels();
+        initEarth();
+
+        // check
+        int n_bad = 0;
+        for (int k = 1; k < n_kernels; k++) {
+            int nb = checkKernel (kernels[k]);
+            printf ("earthspan: %-7s %d of %d spans differ from scalar\n", kernels[k].name, nb, N_CHECK);
+            n_bad += nb;
+        }
+
+        // time each kernel on each kind of span, ns per pixel
+        static Adafruit_RA8875::EarthSpan spans[N_TIME];
+        static uint32_t dst[N_TIME*FB_EARTH_LANES];
+        static const struct {
+            const char *name;
+            int wday;
+        } kinds[] = {
+            {"day", FB_EARTH_WMAX},
+            {"blend", FB_EARTH_WMAX/2},
+            {"sun", -1},
+        };
+        printf ("earthspan: ns per pixel, %d pixel spans\n", FB_EARTH_LANES);
+        printf ("  %-7s", "");
+        for (unsigned j = 0; j < sizeof(kinds)/sizeof(kinds[0]); j++)
+            printf (" %8s", kinds[j].name);
+        printf ("\n");
+        for (int k = 0; k < n_kernels; k++) {
+            printf ("  %-7s", kernels[k].name);
+            for (unsigned j = 0; j < sizeof(kinds)/sizeof(kinds[0]); j++) {
+                for (int i = 0; i < N_TIME; i++)
+                    spans[i] = randomSpan (kinds[j].wday);
+                TimePass tp = {kernels[k].f, spans, dst};
+                double dt = benchBest (50, timePass, &tp);
+                printf (" %8.2f", dt*1e9/(N_TIME*FB_EARTH_LANES));
+            }
+            printf ("\n");
+        }
+
+        return (n_bad ? 1 : 0);
+}
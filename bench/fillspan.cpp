@@ -0,0 +1,170 @@
+/* check each span fill kernel against fillSpanScalar() then time fillRect() before and after them.
+ *
+ * every kernel built for this host must fill exactly the n pixels asked at every alignment. fillRect()
+ * must leave the same canvas as the per-pixel plot32() loop it replaced, which is timed against it on
+ * a plot pane and the full screen. exits 1 if any check fails.
+ */
+
+#define private public
+#define protected public
+#include "../ArduinoLib/Adafruit_RA8875.cpp"
+#undef private
+#undef protected
+#include "benchtft.h"
+
+#define MAX_N           300                             // longest span to check
+#define GUARD           0xDEADBEEF                      // fills dst around the span
+#define COLOR32         0x00123456                      // any fill color
+
+typedef struct {
+        const char *name;
+        Adafruit_RA8875::FillSpanFunc f;
+} Kernel;
+
+static Kernel kernels[4];
+static int n_kernels;
+
+/* collect each kernel this host can run, scalar first.
+ */
+static void findKernels (void)
+{
+        kernels[n_kernels++] = (Kernel){"scalar", fillSpanScalar};
+#if defined(_FILL_X86)
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports ("sse2"))
+            kernels[n_kernels++] = (Kernel){"SSE2", fillSpanSSE2};
+        if (__builtin_cpu_supports ("avx2"))
+            kernels[n_kernels++] = (Kernel){"AVX2", fillSpanAVX2};
+#endif
+#if defined(_FILL_NEON)
+        kernels[n_kernels++] = (Kernel){"NEON", fillSpanNEON};
+#endif
+}
+
+/* fill every length up to MAX_N at each of 8 alignments, return number of spans filled wrong.
+ */
+static int checkKernel (const Kernel &k)
+{
+        static uint32_t buf[MAX_N + 16];
+        int n_bad = 0;
+
+        for (int a = 0; a < 8; a++) {
+            for (int n = 0; n <= MAX_N; n++) {
+                for (int i = 0; i < MAX_N + 16; i++)
+                    buf[i] = GUARD;
+                (*k.f) (&buf[a], COLOR32, n);
+                for (int i = 0; i < MAX_N + 16; i++) {
+                    if (buf[i] != (i >= a && i < a+n ? COLOR32 : GUARD)) {
+                        if (n_bad++ < 5)
+                            printf ("  %s wrong at alignment %d n %d\n", k.name, a, n);
+                        break;
+                    }
+                }
+            }
+        }
+
+        return (n_bad);
+}
+
+/* fillRect() as it was, one plot32() per pixel.
+ */
+static void oldFillRect (int16_t x0, int16_t y0, int16_t w, int16_t h, uint16_t color16)
+{
+        uint32_t c32 = RGB1632(color16);
+        x0 *= tft.SCALESZ;
+        y0 *= tft.SCALESZ;
+        if (w == 0)
+            w = 1;
+        if (h == 0)
+            h = 1;
+        w *= tft.SCALESZ;
+        h *= tft.SCALESZ;
+        tft.lockFB();
+            for (int y = y0; y < y0+h; y++)
+                for (int x = x0; x < x0+w; x++)
+                    tft.plot32 (x, y, c32);
+            tft.markDirty (x0, y0, x0+w-1, y0+h-1);
+        tft.unlockFB();
+}
+
+// one timed fill, in app coords
+typedef struct {
+        bool old;
+        int16_t x, y, w, h;
+} RectPass;
+
+static void rectPass (void *arg)
+{
+        RectPass *rp = (RectPass *) arg;
+        if (rp->old)
+            oldFillRect (rp->x, rp->y, rp->w, rp->h, RA8875_BLUE);
+        else
+            tft.fillRect (rp->x, rp->y, rp->w, rp->h, RA8875_BLUE);
+}
+
+/* return whether old and new fillRect() leave the same canvas for a few awkward rects.
+ */
+static bool checkFillRect (void)
+{
+        static const int16_t rects[][4] = {
+            {0, 0, 800, 480}, {1, 1, 1, 1}, {3, 7, 0, 0}, {13, 29, 77, 5}, {790, 470, 10, 10},
+        };
+        size_t n_bytes = FB_XRES*FB_YRES*sizeof(uint32_t);
+        uint32_t *want = (uint32_t *) malloc (n_bytes);
+        bool ok = true;
+
+        for (unsigned i = 0; i < sizeof(rects)/sizeof(rects[0]); i++) {
+            const int16_t *r = rects[i];
+            memset (tft.fb_canvas, 0, n_bytes);
+            oldFillRect (r[0], r[1], r[2], r[3], RA8875_RED);
+            memcpy (want, tft.fb_canvas, n_bytes);
+            memset (tft.fb_canvas, 0, n_bytes);
+            tft.fillRect (r[0], r[1], r[2], r[3], RA8875_RED);
+            if (memcmp (want, tft.fb_canvas, n_bytes)) {
+                printf ("  fillRect %d %d %d %d differs from per-pixel\n", r[0], r[1], r[2], r[3]);
+                ok = false;
+            }
+        }
+
+        free (want);
+        return (ok);
+}
+
+int main (int ac, char *av[])
+{
+        (void) ac;
+        (void) av;
+
+        findKernels();
+        benchInitTFT();
+
+        // check
+        int n_bad = 0;
+        for (int k = 1; k < n_kernels; k++) {
+            int nb = checkKernel (kernels[k]);
+            printf ("fillspan: %-6s %d spans filled wrong\n", kernels[k].name, nb);
+            n_bad += nb;
+        }
+        if (!checkFillRect())
+            n_bad++;
+
+        // time per-pixel against tft's kernel on a 160x149 plot pane and the full screen
+        static const struct {
+            const char *name;
+            int16_t x, y, w, h;
+        } areas[] = {
+            {"pane", 0, 0, 160, 149},
+            {"screen", 0, 0, 800, 480},
+        };
+        printf ("fillspan: fillRect at %dx%d with %s, best of 50, ms\n", FB_XRES, FB_YRES, tft.fill_span_name);
+        for (unsigned a = 0; a < sizeof(areas)/sizeof(areas[0]); a++) {
+            RectPass old_rp = {true, areas[a].x, areas[a].y, areas[a].w, areas[a].h};
+            RectPass new_rp = {false, areas[a].x, areas[a].y, areas[a].w, areas[a].h};
+            double t_old = benchBest (50, rectPass, &old_rp);
+            double t_new = benchBest (50, rectPass, &new_rp);
+            printf ("  %-7s per-pixel %7.3f  span %7.3f  x%.1f\n", areas[a].name, t_old*1e3, t_new*1e3,
+                            t_old/t_new);
+        }
+
+        return (n_bad ? 1 : 0);
+}
@@ -0,0 +1,152 @@
+/* check the cached glyph runs against the per-bit glyph drawing they replaced then time the two.
+ *
+ * every printable char of each font must leave the same canvas either way. a clock/call line is then
+ * drawn repeatedly each way in each font. exits 1 if any char differs.
+ */
+
+#define private public
+#define protected public
+#include "../ArduinoLib/Adafruit_RA8875.cpp"
+#undef private
+#undef protected
+#include "benchtft.h"
+
+// fonts from the application
+extern const GFXfont Germano_Regular16pt7b;
+extern const GFXfont Germano_Bold30pt7b;
+
+#define N_LINES         1000                            // lines per timing pass
+#define LINE_X          2                               // where each line starts, app coords
+#define LINE_Y          100
+
+static const struct {
+        const char *name;
+        const GFXfont *font;
+} fonts[] = {
+        {"Courier6", &Courier_Prime_Sans6pt7b},
+        {"GermanoR16", &Germano_Regular16pt7b},
+        {"GermanoB30", &Germano_Bold30pt7b},
+};
+
+/* draw ch at the cursor as plotChar() did before the glyph cache, one plot32() per set bit.
+ * N.B. no clipping, as then
+ */
+static void oldPlotChar (char ch)
+{
+        const GFXfont *font = tft.current_font;
+        if (ch < font->first || ch > font->last)
+            ch = '?';
+        GFXglyph *gp = &font->glyph[ch-font->first];
+        uint8_t *bp = &font->bitmap[gp->bitmapOffset];
+        int16_t x = tft.cursor_x + gp->xOffset;
+        int16_t y = tft.cursor_y + gp->yOffset;
+        uint16_t bitn = 0;
+        tft.lockFB();
+            for (uint16_t r = 0; r < gp->height; r++) {
+                for (uint16_t c = 0; c < gp->width; c++) {
+                    uint8_t bit = bp[bitn/8] & (1 << (7-(bitn%8)));
+                    if (bit)
+                        tft.plot32 (x+c, y+r, tft.text_color32);
+                    bitn++;
+                }
+            }
+            tft.markDirty (x, y, x+gp->width-1, y+gp->height-1);
+        tft.unlockFB();
+
+        tft.cursor_x += gp->xAdvance;
+}
+
+/* return how many leading chars of s fit on the canvas from LINE_X in the current font.
+ */
+static int fitLine (const char *s)
+{
+        int x = LINE_X*tft.SCALESZ;
+        int n;
+        for (n = 0; s[n]; n++) {
+            const GFXglyph *gp = &tft.current_font->glyph[s[n]-tft.current_font->first];
+            if (x + gp->xOffset + gp->width > FB_XRES)
+                break;
+            x += gp->xAdvance;
+        }
+        return (n);
+}
+
+/* return number of printable chars that draw differently from the per-bit path in the current font.
+ */
+static int checkFont (const char *name)
+{
+        size_t n_bytes = FB_XRES*FB_YRES*sizeof(uint32_t);
+        uint32_t *want = (uint32_t *) malloc (n_bytes);
+        int n_bad = 0;
+
+        for (char c = ' '; c <= '~'; c++) {
+            memset (tft.fb_canvas, 0, n_bytes);
+            tft.setCursor (LINE_X, LINE_Y);
+            oldPlotChar (c);
+            memcpy (want, tft.fb_canvas, n_bytes);
+            memset (tft.fb_canvas, 0, n_bytes);
+            tft.setCursor (LINE_X, LINE_Y);
+            tft.print (c);
+            if (memcmp (want, tft.fb_canvas, n_bytes)) {
+                if (n_bad++ < 5)
+                    printf ("  %s '%c' differs from per-bit\n", name, c);
+            }
+        }
+
+        free (want);
+        return (n_bad);
+}
+
+// one timing pass: N_LINES lines of n chars of s
+typedef struct {
+        bool old;
+        const char *s;
+        int n;
+} LinePass;
+
+static void linePass (void *arg)
+{
+        LinePass *lp = (LinePass *) arg;
+        char line[100];
+        memcpy (line, lp->s, lp->n);
+        line[lp->n] = '\0';
+
+        for (int i = 0; i < N_LINES; i++) {
+            tft.setCursor (LINE_X, LINE_Y);
+            if (lp->old) {
+                for (int j = 0; j < lp->n; j++)
+                    oldPlotChar (line[j]);
+            } else
+                tft.print (line);
+        }
+}
+
+int main (int ac, char *av[])
+{
+        (void) ac;
+        (void) av;
+
+        static const char clock_line[] = "12:34:56 UTC  Sat 17 Oct WB0OEW";
+        int n_bad = 0;
+
+        benchInitTFT();
+        tft.setTextColor (RA8875_WHITE);
+
+        printf ("glyphs: at %dx%d, Mchars/s\n", FB_XRES, FB_YRES);
+        for (unsigned f = 0; f < sizeof(fonts)/sizeof(fonts[0]); f++) {
+            tft.setFont (fonts[f].font);
+
+            int nb = checkFont (fonts[f].name);
+            n_bad += nb;
+
+            int n = fitLine (clock_line);
+            LinePass old_lp = {true, clock_line, n};
+            LinePass new_lp = {false, clock_line, n};
+            double t_old = benchBest (10, linePass, &old_lp);
+            double t_new = benchBest (10, linePass, &new_lp);
+            printf ("  %-10s %2d chars  per-bit %6.2f  runs %6.2f  x%.1f  %d chars differ\n", fonts[f].name, n,
+                        N_LINES*n/t_old*1e-6, N_LINES*n/t_new*1e-6, t_old/t_new, nb);
+        }
+
+        return (n_bad ? 1 : 0);
+}
@@ -0,0 +1,175 @@
+/* stand-in for the few NEON intrinsics Adafruit_RA8875.cpp uses, in portable gcc vector extensions.
+ * lets the NEON kernels be compiled and checked on a host with no ARM toolchain. see Makefile.
+ * each follows the ARM definition lane by lane; this is not a general purpose NEON emulation.
+ */
+
+#ifndef _BENCH_ARM_NEON_H
+#define _BENCH_ARM_NEON_H
+
+#include <stdint.h>
+#include <string.h>
+
+typedef int32_t int32x4_t __attribute__ ((vector_size (16)));
+typedef uint32_t uint32x4_t __attribute__ ((vector_size (16)));
+typedef float float32x4_t __attribute__ ((vector_size (16)));
+
+// load, store and duplicate
+
+static inline int32x4_t vld1q_s32 (const int32_t *p)
+{
+        int32x4_t v;
+        memcpy (&v, p, sizeof(v));
+        return (v);
+}
+
+static inline uint32x4_t vld1q_u32 (const uint32_t *p)
+{
+        uint32x4_t v;
+        memcpy (&v, p, sizeof(v));
+        return (v);
+}
+
+static inline float32x4_t vld1q_f32 (const float *p)
+{
+        float32x4_t v;
+        memcpy (&v, p, sizeof(v));
+        return (v);
+}
+
+static inline void vst1q_u32 (uint32_t *p, uint32x4_t v)
+{
+        memcpy (p, &v, sizeof(v));
+}
+
+static inline int32x4_t vdupq_n_s32 (int32_t x)
+{
+        return ((int32x4_t){x, x, x, x});
+}
+
+static inline uint32x4_t vdupq_n_u32 (uint32_t x)
+{
+        return ((uint32x4_t){x, x, x, x});
+}
+
+static inline float32x4_t vdupq_n_f32 (float x)
+{
+        return ((float32x4_t){x, x, x, x});
+}
+
+// reinterpret
+
+static inline int32x4_t vreinterpretq_s32_u32 (uint32x4_t v)
+{
+        return ((int32x4_t)v);
+}
+
+static inline uint32x4_t vreinterpretq_u32_s32 (int32x4_t v)
+{
+        return ((uint32x4_t)v);
+}
+
+// integer arithmetic, all modulo 2^32
+
+static inline int32x4_t vaddq_s32 (int32x4_t a, int32x4_t b)
+{
+        return ((int32x4_t)((uint32x4_t)a + (uint32x4_t)b));
+}
+
+static inline int32x4_t vsubq_s32 (int32x4_t a, int32x4_t b)
+{
+        return ((int32x4_t)((uint32x4_t)a - (uint32x4_t)b));
+}
+
+static inline uint32x4_t vsubq_u32 (uint32x4_t a, uint32x4_t b)
+{
+        return (a - b);
+}
+
+static inline uint32x4_t vmulq_u32 (uint32x4_t a, uint32x4_t b)
+{
+        return (a * b);
+}
+
+static inline uint32x4_t vmlaq_u32 (uint32x4_t a, uint32x4_t b, uint32x4_t c)
+{
+        return (a + b * c);
+}
+
+static inline int32x4_t vmlaq_n_s32 (int32x4_t a, int32x4_t b, int32_t c)
+{
+        return ((int32x4_t)((uint32x4_t)a + (uint32x4_t)b * (uint32_t)c));
+}
+
+static inline uint32x4_t vmlaq_n_u32 (uint32x4_t a, uint32x4_t b, uint32_t c)
+{
+        return (a + b * c);
+}
+
+static inline int32x4_t vminq_s32 (int32x4_t a, int32x4_t b)
+{
+        return (a < b ? a : b);
+}
+
+static inline int32x4_t vmaxq_s32 (int32x4_t a, int32x4_t b)
+{
+        return (a > b ? a : b);
+}
+
+// bitwise and shifts
+
+static inline int32x4_t vandq_s32 (int32x4_t a, int32x4_t b)
+{
+        return (a & b);
+}
+
+static inline uint32x4_t vandq_u32 (uint32x4_t a, uint32x4_t b)
+{
+        return (a & b);
+}
+
+static inline uint32x4_t vorrq_u32 (uint32x4_t a, uint32x4_t b)
+{
+        return (a | b);
+}
+
+#define vshlq_n_u32(a,n)        ((uint32x4_t)((a) << (n)))
+#define vshrq_n_u32(a,n)        ((uint32x4_t)((a) >> (n)))
+
+// compares, each lane all ones if true
+
+static inline uint32x4_t vcltq_s32 (int32x4_t a, int32x4_t b)
+{
+        return ((uint32x4_t)(a < b));
+}
+
+static inline uint32x4_t vcgeq_s32 (int32x4_t a, int32x4_t b)
+{
+        return ((uint32x4_t)(a >= b));
+}
+
+// float
+
+static inline float32x4_t vsubq_f32 (float32x4_t a, float32x4_t b)
+{
+        return (a - b);
+}
+
+static inline float32x4_t vmulq_n_f32 (float32x4_t a, float b)
+{
+        return (a * b);
+}
+
+// N.B. not fused, as vmla on ARMv7 and AArch64
+static inline float32x4_t vmlaq_f32 (float32x4_t a, float32x4_t b, float32x4_t c)
+{
+        float32x4_t p = b * c;
+        return (a + p);
+}
+
+// truncates toward zero; ARM saturates out of range but the kernels clamp right after
+static inline int32x4_t vcvtq_s32_f32 (float32x4_t a)
+{
+        return (__builtin_convertvector (a, int32x4_t));
+}
+
+#endif // _BENCH_ARM_NEON_H
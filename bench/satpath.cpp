@@ -0,0 +1,109 @@
+/* time a 2000 point one-rev ground track as updateSatPath() builds it, one predict() and geo() per
+ * point as before versus predictMany() and geoMany() in batches as now.
+ *
+ * also checks the two agree, exits 1 if any point differs by more than MAX_DIFF.
+ */
+
+#include "P13.h"
+#include "bench.h"
+
+#define N_PATH          2000                            // points per rev, as MAX_PATH in earthsat.cpp
+#define PATH_BATCH      50                              // points per batch, as in earthsat.cpp
+#define N_REPS          200                             // timing passes, best is reported
+#define MAX_DIFF        0.01F                           // max lat or lng difference, rads
+
+typedef struct {
+        const char *name;
+        const char *l1, *l2;
+} TestSat;
+
+static const TestSat sats[] = {
+        {"ISS",
+            "1 25544U 98067A   26289.50000000  .00016717  00000-0  10270-3 0  9005",
+            "2 25544  51.6416 247.4627 0006703 130.5360 325.0288 15.49815300123457"},
+        {"Molniya",
+            "1 28117U 03052A   26289.50000000 -.00000088  00000-0  00000+0 0  9993",
+            "2 28117  63.4000 120.0000 6900000 270.0000  10.0000  2.00600000123456"},
+};
+
+typedef struct {
+        Satellite *sat;
+        DateTime t0;
+        float lat[N_PATH], lng[N_PATH];
+} PathPass;
+
+/* one path, one point at a time
+ */
+static void pathEach (void *arg)
+{
+        PathPass *pp = (PathPass *) arg;
+        float step = pp->sat->period()/N_PATH;
+        DateTime t = pp->t0;
+
+        for (int p = 0; p < N_PATH; p++) {
+            pp->sat->predict (t);
+            pp->sat->geo (pp->lat[p], pp->lng[p]);
+            t += step;
+        }
+}
+
+/* one path, PATH_BATCH points at a time
+ */
+static void pathMany (void *arg)
+{
+        PathPass *pp = (PathPass *) arg;
+        float step = pp->sat->period()/N_PATH;
+        DateTime t = pp->t0;
+
+        for (int p0 = 0; p0 < N_PATH; p0 += PATH_BATCH) {
+            DateTime bt[PATH_BATCH];
+            float bx[PATH_BATCH], by[PATH_BATCH], bz[PATH_BATCH];
+            SatStates ss = {{bx, by, bz}, {NULL, NULL, NULL}};
+            for (int i = 0; i < PATH_BATCH; i++) {
+                bt[i] = t;
+                t += step;
+            }
+            pp->sat->predictMany (bt, PATH_BATCH, ss);
+            Satellite::geoMany (ss, PATH_BATCH, &pp->lat[p0], &pp->lng[p0]);
+        }
+}
+
+int main (int ac, char *av[])
+{
+        (void) ac;
+        (void) av;
+
+        static PathPass each, many;
+        int n_bad = 0;
+
+        printf ("satpath: %d point path, best of %d, us\n", N_PATH, N_REPS);
+        for (unsigned s = 0; s < sizeof(sats)/sizeof(sats[0]); s++) {
+            Satellite sat (sats[s].l1, sats[s].l2);
+            DateTime t0 (2026, 10, 17, 12, 0, 0);
+            each.sat = many.sat = &sat;
+            each.t0 = many.t0 = t0;
+
+            double t_each = benchBest (N_REPS, pathEach, &each);
+            double t_many = benchBest (N_REPS, pathMany, &many);
+
+            float max_d = 0;
+            for (int p = 0; p < N_PATH; p++) {
+                float dlat = fabsf (each.lat[p] - many.lat[p]);
+                float dlng = fabsf (each.lng[p] - many.lng[p]);
+                if (dlng > M_PI)
+                    dlng = 2*M_PI - dlng;
+                if (dlat > max_d)
+                    max_d = dlat;
+                if (dlng > max_d)
+                    max_d = dlng;
+            }
+            if (max_d > MAX_DIFF)
+                n_bad++;
+
+            printf ("  %-8s predict+geo %7.1f  predictMany+geoMany %7.1f  x%.2f  max diff %.1e rad%s\n",
+                            sats[s].name, t_each*1e6, t_many*1e6, t_each/t_many, max_d,
+                            max_d > MAX_DIFF ? " TOO BIG" : "");
+        }
+
+        return (n_bad ? 1 : 0);
+}
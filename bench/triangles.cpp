@@ -0,0 +1,244 @@
+/* check fillTriangle() and fillPolygon() at SCALESZ 1 and 4 then time fillTriangle() before and after.
+ *
+ * upright triangles must fill exactly as the upright-only fillTriangle() did before polygons. any
+ * triangle must fill just the fb pixels on or inside its edges, vertices included. two triangles
+ * from fillPolygon() sharing a diagonal must tile their quad with no gap or overlap. exits 1 if not.
+ */
+
+#define private public
+#define protected public
+#include "../ArduinoLib/Adafruit_RA8875.cpp"
+#undef private
+#undef protected
+#include "benchtft.h"
+
+#define N_TRI           300                             // random shapes per check
+#define N_BEACONS       10000                           // triangles per timing pass
+#define APP_MAX         100                             // app coords range, fits the canvas at SCALESZ 4
+
+/* fillTriangle() as it was, only for x0,y0 top with x1,y1 left and x2,y2 right at equal height.
+ */
+static void oldFillTriangle (int16_t x0, int16_t y0, int16_t x1, int16_t y1, int16_t x2, int16_t y2,
+    uint16_t color16)
+{
+        uint32_t c32 = RGB1632(color16);
+        int SCALESZ = tft.SCALESZ;
+        x0 *= SCALESZ;
+        y0 *= SCALESZ;
+        x1 *= SCALESZ;
+        y1 *= SCALESZ;
+        x2 *= SCALESZ;
+        y2 *= SCALESZ;
+        int dy = y1 - y0;
+        int dx = x2 - x0;
+        tft.lockFB();
+            for (int y = y0; y <= y1; y++) {
+                int xleft = x0 - dx*(y-y0)/dy;
+                int xrite = x0 + dx*(y-y0)/dy;
+                if (xleft > xrite) {
+                    int t = xleft; xleft = xrite; xrite = t;
+                }
+                tft.fillSpan (xleft, y, xrite-xleft+1, c32);
+            }
+            tft.markDirty (x0-dx, y0, x0+dx, y1);
+        tft.unlockFB();
+}
+
+static void clearCanvas (void)
+{
+        memset (tft.fb_canvas, 0, FB_XRES*FB_YRES*sizeof(uint32_t));
+}
+
+/* return twice the signed area of a,b,c, > 0 if counter-clockwise on screen
+ */
+static int64_t cross (int64_t ax, int64_t ay, int64_t bx, int64_t by, int64_t cx, int64_t cy)
+{
+        return ((bx - ax)*(cy - ay) - (by - ay)*(cx - ax));
+}
+
+/* upright triangles must match the old fill pixel for pixel, return number that differ.
+ */
+static int checkUpright (void)
+{
+        size_t n_bytes = FB_XRES*FB_YRES*sizeof(uint32_t);
+        uint32_t *want = (uint32_t *) malloc (n_bytes);
+        int n_bad = 0;
+
+        for (int i = 0; i < N_TRI; i++) {
+            int16_t x0, y0, dx, dy;
+            if (i == 0) {
+                // the case from review
+                x0 = 20; y0 = 10; dx = 8; dy = 5;
+            } else {
+                dx = 1 + benchRand() % (APP_MAX/3);
+                dy = 1 + benchRand() % (APP_MAX/3);
+                x0 = dx + benchRand() % (APP_MAX - 2*dx);
+                y0 = benchRand() % (APP_MAX - dy);
+            }
+            clearCanvas();
+            oldFillTriangle (x0, y0, x0-dx, y0+dy, x0+dx, y0+dy, RA8875_RED);
+            memcpy (want, tft.fb_canvas, n_bytes);
+            clearCanvas();
+            tft.fillTriangle (x0, y0, x0-dx, y0+dy, x0+dx, y0+dy, RA8875_RED);
+            if (memcmp (want, tft.fb_canvas, n_bytes)) {
+                if (n_bad++ < 5)
+                    printf ("  upright %d %d %d %d differs from old\n", x0, y0, dx, dy);
+            }
+        }
+
+        free (want);
+        return (n_bad);
+}
+
+/* any triangle must fill exactly the fb pixels on or inside it, return number that do not.
+ */
+static int checkInclusive (void)
+{
+        uint32_t c32 = RGB1632(RA8875_RED);
+        int S = tft.SCALESZ;
+        int n_bad = 0;
+
+        for (int i = 0; i < N_TRI; i++) {
+            int16_t x[3], y[3];
+            for (int k = 0; k < 3; k++) {
+                x[k] = benchRand() % APP_MAX;
+                y[k] = benchRand() % APP_MAX;
+            }
+            clearCanvas();
+            tft.fillTriangle (x[0], y[0], x[1], y[1], x[2], y[2], RA8875_RED);
+
+            int64_t area = cross (x[0], y[0], x[1], y[1], x[2], y[2]);
+            int sign = area < 0 ? -1 : 1;
+            bool bad = false;
+            for (int py = 0; py < APP_MAX*S && !bad; py++) {
+                for (int px = 0; px < APP_MAX*S && !bad; px++) {
+                    bool in;
+                    if (area == 0) {
+                        // degenerate: on the segment between the extreme vertices
+                        in = false;
+                        for (int a = 0; a < 3; a++) {
+                            int b = (a+1)%3;
+                            int64_t ax = x[a]*S, ay = y[a]*S, bx = x[b]*S, by = y[b]*S;
+                            if (cross (ax, ay, bx, by, px, py) == 0
+                                        && px >= (ax < bx ? ax : bx) && px <= (ax < bx ? bx : ax)
+                                        && py >= (ay < by ? ay : by) && py <= (ay < by ? by : ay))
+                                in = true;
+                        }
+                    } else {
+                        in = true;
+                        for (int a = 0; a < 3; a++) {
+                            int b = (a+1)%3;
+                            if (sign*cross (x[a]*S, y[a]*S, x[b]*S, y[b]*S, px, py) < 0)
+                                in = false;
+                        }
+                    }
+                    if (in != (tft.fb_canvas[py*FB_XRES + px] == c32))
+                        bad = true;
+                }
+            }
+            if (bad && n_bad++ < 5)
+                printf ("  triangle %d,%d %d,%d %d,%d not vertex-inclusive\n", x[0], y[0], x[1], y[1],
+                                    x[2], y[2]);
+        }
+
+        return (n_bad);
+}
+
+/* two fillPolygon() triangles on either side of a quad diagonal must fill the quad exactly once.
+ * return number of quads that overlap or differ from fillPolygon() of the whole quad.
+ */
+static int checkShared (void)
+{
+        size_t n_pix = FB_XRES*FB_YRES;
+        uint32_t *want = (uint32_t *) malloc (n_pix*sizeof(uint32_t));
+        uint32_t *a = (uint32_t *) malloc (n_pix*sizeof(uint32_t));
+        uint32_t c1 = RGB1632(RA8875_RED), c2 = RGB1632(RA8875_GREEN);
+        int n_bad = 0;
+
+        for (int i = 0; i < N_TRI; i++) {
+            // convex quad: one point in each quadrant around a center
+            int16_t cx = APP_MAX/2, cy = APP_MAX/2, h = APP_MAX/2 - 1;
+            int16_t x[4] = {(int16_t)(cx - 1 - benchRand()%h), (int16_t)(cx + 1 + benchRand()%h),
+                            (int16_t)(cx + 1 + benchRand()%h), (int16_t)(cx - 1 - benchRand()%h)};
+            int16_t y[4] = {(int16_t)(cy - 1 - benchRand()%h), (int16_t)(cy - 1 - benchRand()%h),
+                            (int16_t)(cy + 1 + benchRand()%h), (int16_t)(cy + 1 + benchRand()%h)};
+            if (cross (x[0], y[0], x[1], y[1], x[2], y[2]) <= 0 || cross (x[1], y[1], x[2], y[2], x[3], y[3]) <= 0
+                        || cross (x[2], y[2], x[3], y[3], x[0], y[0]) <= 0
+                        || cross (x[3], y[3], x[0], y[0], x[1], y[1]) <= 0)
+                continue;
+
+            clearCanvas();
+            tft.fillPolygon (x, y, 4, RA8875_RED);
+            memcpy (want, tft.fb_canvas, n_pix*sizeof(uint32_t));
+
+            // each triangle alone in its own color, count pixels both fill
+            int16_t ax[3] = {x[0], x[1], x[2]}, ay[3] = {y[0], y[1], y[2]};
+            int16_t bx[3] = {x[0], x[2], x[3]}, by[3] = {y[0], y[2], y[3]};
+            clearCanvas();
+            tft.fillPolygon (ax, ay, 3, RA8875_RED);
+            memcpy (a, tft.fb_canvas, n_pix*sizeof(uint32_t));
+            clearCanvas();
+            tft.fillPolygon (bx, by, 3, RA8875_GREEN);
+            bool bad = false;
+            for (size_t p = 0; p < n_pix && !bad; p++) {
+                bool ina = a[p] == c1, inb = tft.fb_canvas[p] == c2;
+                if ((ina && inb) || (ina || inb) != (want[p] == c1))
+                    bad = true;
+            }
+            if (bad && n_bad++ < 5)
+                printf ("  quad %d,%d %d,%d %d,%d %d,%d does not tile\n", x[0], y[0], x[1], y[1], x[2], y[2],
+                                    x[3], y[3]);
+        }
+
+        free (a);
+        free (want);
+        return (n_bad);
+}
+
+// one timing pass: N_BEACONS beacon symbols, as drawn by ncdxf.cpp
+typedef struct {
+        bool old;
+} TriPass;
+
+static void triPass (void *arg)
+{
+        TriPass *tp = (TriPass *) arg;
+        const int r = 8;
+        for (int i = 0; i < N_BEACONS; i++) {
+            int16_t x = 20 + i%50, y = 20 + i%40;
+            if (tp->old)
+                oldFillTriangle (x, y-r, x-9*r/10, y+r/2, x+9*r/10, y+r/2, RA8875_RED);
+            else
+                tft.fillTriangle (x, y-r, x-9*r/10, y+r/2, x+9*r/10, y+r/2, RA8875_RED);
+        }
+}
+
+int main (int ac, char *av[])
+{
+        (void) ac;
+        (void) av;
+
+        benchInitTFT();
+
+        int n_bad = 0;
+        static const int scales[] = {1, 4};
+        for (unsigned s = 0; s < sizeof(scales)/sizeof(scales[0]); s++) {
+            tft.SCALESZ = scales[s];
+            int nu = checkUpright();
+            int ni = checkInclusive();
+            int ns = checkShared();
+            printf ("triangles: SCALESZ %d: %d upright differ from old, %d not vertex-inclusive, "
+                            "%d quads do not tile\n", scales[s], nu, ni, ns);
+            n_bad += nu + ni + ns;
+        }
+
+        tft.SCALESZ = FB_XRES/APP_WIDTH;
+        TriPass old_tp = {true};
+        TriPass new_tp = {false};
+        double t_old = benchBest (10, triPass, &old_tp);
+        double t_new = benchBest (10, triPass, &new_tp);
+        printf ("triangles: beacons at %dx%d, upright-only %.3f  any %.3f us each  x%.2f\n", FB_XRES, FB_YRES,
+                    t_old/N_BEACONS*1e6, t_new/N_BEACONS*1e6, t_old/t_new);
+
+        return (n_bad ? 1 : 0);
+}
@@ -34,8 +34,89 @@ uint8_t show_lp;                                // display long path, else short
 
 #define	GRAYLINE_COS	(-0.208F)	        // cos(90 + grayline angle), we use 12 degs
 #define	GRAYLINE_POW	(0.75F)	                // cos power exponent, sqrt is too severe, 1 is too gradual
+#if !defined(_USE_DESKTOP)
+#define GRAYLINE_N      256                     // steps in grayline power curve table
+static float grayline_night[GRAYLINE_N+1];      // fraction of night at each step across grayline
+static bool grayline_ok;                        // set when grayline_night[] is built
+
+// rather than test each map pixel against every symbol and obstruction, the sweep first looks up one bit
+// for the OCC_T x OCC_T tile of map_b holding it; the exact tests are only needed within marked tiles.
+#define OCC_T           8                       // map pixels on each side of an occupancy tile
+#define OCC_NX          ((EARTH_W*EARTH_XW+OCC_T-1)/OCC_T)      // tiles across map_b
+#define OCC_NY          ((EARTH_H*EARTH_XH+OCC_T-1)/OCC_T)      // tiles down map_b
+typedef uint8_t OccMask[OCC_NY][(OCC_NX+7)/8];
+static OccMask occ_sym;                         // tiles touched by any symbol
+static OccMask occ_obs;                         // tiles touched by the RSS banner or map buttons
+typedef struct {
+    SCoord de, dx, deap, sun, moon;             // symbol centers
+    SBox santa;                                 // santa_b
+    uint8_t rss_on, brb_mode;                   // whether banner and beacons are showing
+} OccKey;
+static OccKey occ_key;                          // state when masks were built
+static bool occ_ok;                             // set when masks have been built
+static void drawMapLL (const SCoord &s, const LatLong &lls);
+#endif
 static SCoord moremap_s;		        // drawMoreEarth() scanning location 
 
+// map sweep timing, see getMapPerf()
+uint8_t log_map_perf;                           // set to print the phase times of each sweep
+static uint32_t mp_us[MP_N][MP_NS];             // most recent samples of each phase, usecs
+static uint32_t mp_n[MP_N];                     // n samples ever added to each phase
+static uint32_t mp_sweep[MP_N];                 // usecs so far in each phase of this sweep
+static uint32_t mp_t0;                          // micros() when this sweep started
+static bool s2llGlobe (const SCoord &s, LatLong &ll);
+
+#if defined(_USE_DESKTOP)
+
+// screen-to-lat/lng only depends on DE, projection and map_b so desktops find it once for each
+// map pixel, along with the changes to the pixels right and below for plotEarth to interpolate.
+typedef struct {
+    LatLong ll;                                 // location at this pixel, lat_d is NAN if off globe
+    float dlat_r, dlng_r;                       // degrees to the pixel on the right
+    float dlat_d, dlng_d;                       // degrees to the pixel below
+} MapLL;
+static MapLL *map_ll;                           // malloced map_b.w x map_b.h, else NULL
+static LatLong map_ll_de;                       // de_ll when map_ll was built
+static uint8_t map_ll_azm;                      // azm_on when map_ll was built
+static SBox map_ll_b;                           // map_b when map_ll was built
+static const MapLL *getMapLL (const SCoord &s);
+static void checkMapLL(void);
+static bool findMapLL (const SCoord &s, MapLL &m);
+static void drawMapPixel (const SCoord &s, const MapLL &m, uint8_t *mtiles);
+
+// desktops draw the whole map in the background into an off-screen layer, split into bands of rows
+// claimed by a pool of worker threads, then show it at the end of the sweep. the layer is kept between
+// sweeps so after the first only blocks whose shading changes as the sun moves need be drawn again.
+#if !defined(MAP_THREADS)
+#define MAP_THREADS     0                       // n map workers, 0 for one per online core
+#endif
+#define MAPW_BAND       8                       // rows claimed by a worker at a time
+static pthread_t *mapw_tids;                    // malloced ids of running workers
+static int mapw_n;                              // n workers running, 0 if no sweep in progress
+static volatile int mapw_next;                  // row of map_b for next band, use atomically
+static volatile int mapw_done;                  // n workers finished, use atomically
+static volatile uint32_t mapw_t1;               // micros() when the last worker finished
+static volatile bool mapw_stop;                 // ask workers to quit early
+static uint8_t *mapw_tiles;                     // malloced layer tiles changed by each worker
+static bool map_layer_fresh = true;             // set when the map layer must be drawn in full
+
+// workers test overMap() against this copy of the obstructions made when the sweep starts, since the
+// main loop may change them at any time.
+typedef struct {
+    SBox rss_btn_b, rss_bnr_b, azm_btn_b, llg_btn_b;
+    uint8_t rss_on;
+} MapObs;
+static MapObs map_obs;                          // obstructions for this sweep
+static void stopMapWorkers(void);
+
+// symbols are drawn in the display overlay so showing a new map does not disturb them. they are only
+// drawn again after a sweep if the new circumstances moved any.
+static bool map_stamp_all = true;               // set when all symbols must be drawn after next sweep
+static SCoord map_stamp_sun, map_stamp_moon;    // sun_c.s and moon_c.s when symbols were last drawn
+static bool map_stamp_sat;                      // whether a sat was defined when symbols were last drawn
+
+#endif // _USE_DESKTOP
+
 
 /* erase the DE symbol by restoring map contents.
  * N.B. we assume coords insure marker will be wholy within map boundaries.
@@ -54,9 +135,11 @@ void drawDEMarker(bool force)
     if (!force && !overMap(de_c.s))
         return;
 
+    tft.beginOverlay();
     tft.fillCircle (de_c.s.x, de_c.s.y, DE_R, RA8875_BLACK);
     tft.drawCircle (de_c.s.x, de_c.s.y, DE_R, DE_COLOR);
     tft.fillCircle (de_c.s.x, de_c.s.y, DE_R/2, DE_COLOR);
+    tft.endOverlay();
 }
 
 /* erase the antipode symbol by restoring map contents.
@@ -72,9 +155,11 @@ void eraseDEAPMarker()
  */
 void drawDEAPMarker()
 {
+    tft.beginOverlay();
     tft.fillCircle (deap_c.s.x, deap_c.s.y, DEAP_R, DE_COLOR);
     tft.drawCircle (deap_c.s.x, deap_c.s.y, DEAP_R, RA8875_BLACK);
     tft.fillCircle (deap_c.s.x, deap_c.s.y, DEAP_R/2, RA8875_BLACK);
+    tft.endOverlay();
 }
 
 /* draw de_info_b according to de_time_fmt
@@ -179,18 +264,221 @@ static void updateCircumstances()
     subSolar (utc, sun_ss_ll);
     csslat = cosf(sun_ss_ll.lat);
     ssslat = sinf(sun_ss_ll.lat);
+#if defined(_USE_DESKTOP)
+    tft.setEarthSun (sun_ss_ll.lat, sun_ss_ll.lng, GRAYLINE_COS, GRAYLINE_POW);
+#endif
     ll2s (sun_ss_ll, sun_c.s, SUN_R+1);
     subLunar (utc, moon_ss_ll);
     ll2s (moon_ss_ll, moon_c.s, MOON_R+1);
     updateSatPath();
 }
 
+#if !defined(_USE_DESKTOP)
+
+/* build the grayline power curve table, if not already.
+ */
+static void initGrayline()
+{
+    if (grayline_ok)
+        return;
+    for (int i = 0; i <= GRAYLINE_N; i++)
+        grayline_night[i] = powf ((float)i/GRAYLINE_N, GRAYLINE_POW);
+    grayline_ok = true;
+}
+
+/* return fraction of night given cos_t, the cosine of the angle from the subsolar point.
+ */
+static float fractNight (float cos_t)
+{
+    if (cos_t > 0)
+        return (0);                                     // < 90 deg: sunlit
+    if (cos_t <= GRAYLINE_COS)
+        return (1);                                     // night side
+    initGrayline();
+    return (grayline_night[(int)(cos_t/GRAYLINE_COS*GRAYLINE_N + 0.5F)]);
+}
+
+/* mark the tiles of mask m touched by box b, clipped to map_b.
+ */
+static void occupyBox (OccMask m, const SBox &b)
+{
+    uint16_t x1 = map_b.x + map_b.w, y1 = map_b.y + map_b.h;
+    if (b.w == 0 || b.h == 0 || b.x >= x1 || b.y >= y1 || b.x + b.w <= map_b.x || b.y + b.h <= map_b.y)
+        return;
+
+    // inclusive pixel range within map_b
+    uint16_t px0 = b.x > map_b.x ? b.x - map_b.x : 0;
+    uint16_t py0 = b.y > map_b.y ? b.y - map_b.y : 0;
+    uint16_t px1 = (b.x + b.w < x1 ? b.x + b.w : x1) - map_b.x - 1;
+    uint16_t py1 = (b.y + b.h < y1 ? b.y + b.h : y1) - map_b.y - 1;
+
+    for (uint16_t ty = py0/OCC_T; ty <= py1/OCC_T; ty++)
+        for (uint16_t tx = px0/OCC_T; tx <= px1/OCC_T; tx++)
+            m[ty][tx/8] |= 1 << (tx%8);
+}
+
+/* mark the symbol occupancy tiles touched by box b.
+ */
+void occupyMapBox (const SBox &b)
+{
+    occupyBox (occ_sym, b);
+}
+
+/* mark the symbol occupancy tiles touched by the square enclosing circle c, same extent as inCircle().
+ */
+static void occupyCircle (const SCircle &c)
+{
+    SBox b;
+    b.x = c.s.x - c.r;
+    b.y = c.s.y - c.r;
+    b.w = 2*c.r + 1;
+    b.h = 2*c.r + 1;
+    occupyBox (occ_sym, b);
+}
+
+/* rebuild the occupancy masks if any symbol or obstruction changed since they were last built.
+ */
+static void updateOccupancy()
+{
+    OccKey key;
+    memset (&key, 0, sizeof(key));
+    key.de = de_c.s;
+    key.dx = dx_c.s;
+    key.deap = deap_c.s;
+    key.sun = sun_c.s;
+    key.moon = moon_c.s;
+    key.santa = santa_b;
+    key.rss_on = rss_on;
+    key.brb_mode = brb_mode;
+
+    // N.B. always call beaconsMoved() so it resets
+    bool beacons = beaconsMoved();
+    if (occ_ok && !beacons && memcmp (&key, &occ_key, sizeof(key)) == 0)
+        return;
+
+    memset (occ_sym, 0, sizeof(occ_sym));
+    memset (occ_obs, 0, sizeof(occ_obs));
+
+    // same shapes as overAnySymbol()
+    occupyCircle (de_c);
+    occupyCircle (dx_c);
+    occupyCircle (deap_c);
+    occupyCircle (sun_c);
+    occupyCircle (moon_c);
+    occupyBox (occ_sym, santa_b);
+    occupyBeacons();
+
+    // same shapes as overMap()
+    occupyBox (occ_obs, rss_btn_b);
+    if (rss_on)
+        occupyBox (occ_obs, rss_bnr_b);
+    occupyBox (occ_obs, azm_btn_b);
+    occupyBox (occ_obs, llg_btn_b);
+
+    occ_key = key;
+    occ_ok = true;
+}
+
+/* return whether s lies in a marked tile of mask m.
+ * N.B. s must be within map_b
+ */
+static bool occupied (const OccMask m, const SCoord &s)
+{
+    uint16_t tx = (s.x - map_b.x)/OCC_T;
+    uint16_t ty = (s.y - map_b.y)/OCC_T;
+    return ((m[ty][tx/8] >> (tx%8)) & 1);
+}
+
+#endif // !_USE_DESKTOP
+
+/* start timing a new map sweep.
+ */
+static void mapPerfStart()
+{
+    memset (mp_sweep, 0, sizeof(mp_sweep));
+    mp_t0 = micros();
+}
+
+/* add the time since t0 to phase p of this sweep and return micros() now, ready to time the next phase.
+ */
+static uint32_t mapPerfLap (MapPerfPhase p, uint32_t t0)
+{
+    uint32_t t = micros();
+    mp_sweep[p] += t - t0;
+    return (t);
+}
+
+/* add one sample of usecs to phase p.
+ */
+static void mapPerfAdd (MapPerfPhase p, uint32_t us)
+{
+    mp_us[p][mp_n[p]++ % MP_NS] = us;
+}
+
+/* the map sweep is now showing: record the time of each phase and log if enabled.
+ */
+static void mapPerfDone()
+{
+    mp_sweep[MP_SWEEP] = micros() - mp_t0;
+    mapPerfAdd (MP_SWEEP, mp_sweep[MP_SWEEP]);
+    mapPerfAdd (MP_CIRCUMSTANCES, mp_sweep[MP_CIRCUMSTANCES]);
+    mapPerfAdd (MP_RENDER, mp_sweep[MP_RENDER]);
+    mapPerfAdd (MP_SYMBOLS, mp_sweep[MP_SYMBOLS]);
+#if defined(_USE_DESKTOP)
+    tft.getPRTimes (mp_sweep[MP_STAGE], mp_sweep[MP_PRESENT]);
+    mapPerfAdd (MP_STAGE, mp_sweep[MP_STAGE]);
+    mapPerfAdd (MP_PRESENT, mp_sweep[MP_PRESENT]);
+#endif
+
+    if (log_map_perf)
+        Serial.printf ("Map sweep %lu us: circumstances %lu render %lu symbols %lu stage %lu present %lu\n",
+                (unsigned long)mp_sweep[MP_SWEEP], (unsigned long)mp_sweep[MP_CIRCUMSTANCES],
+                (unsigned long)mp_sweep[MP_RENDER], (unsigned long)mp_sweep[MP_SYMBOLS],
+                (unsigned long)mp_sweep[MP_STAGE], (unsigned long)mp_sweep[MP_PRESENT]);
+}
+
+/* fill stats with the median, 90th percentile and max of the most recent MP_NS sweeps of each phase.
+ */
+void getMapPerf (MapPerfStat stats[MP_N])
+{
+    for (int p = 0; p < MP_N; p++) {
+        MapPerfStat &mp = stats[p];
+        mp.n = mp_n[p];
+        int ns = mp.n < MP_NS ? mp.n : MP_NS;
+        if (ns == 0) {
+            mp.p50 = mp.p90 = mp.max = 0;
+            continue;
+        }
+
+        // insertion sort a copy, it's tiny
+        uint32_t s[MP_NS];
+        for (int i = 0; i < ns; i++) {
+            uint32_t us = mp_us[p][i];
+            int j;
+            for (j = i; j > 0 && s[j-1] > us; --j)
+                s[j] = s[j-1];
+            s[j] = us;
+        }
+
+        mp.p50 = s[(ns-1)*50/100];
+        mp.p90 = s[(ns-1)*90/100];
+        mp.max = s[ns-1];
+    }
+}
+
 /* restart map given de_ll and dx_ll
  */
 void initEarthMap()
 {
     resetWatchdog();
 
+#if defined(_USE_DESKTOP)
+    // abandon any sweep in progress and draw all of the next, then all symbols over it
+    stopMapWorkers();
+    map_layer_fresh = true;
+    map_stamp_all = true;
+#endif
+
     // completely erase map
     tft.fillRect (map_b.x, map_b.y, map_b.w, map_b.h, RA8875_BLACK);
 
@@ -215,6 +503,9 @@ void initEarthMap()
     // update DE and DX info
     sdelat = sinf(de_ll.lat);
     cdelat = cosf(de_ll.lat);
+#if defined(_USE_DESKTOP)
+    checkMapLL();                       // rebuild lookup table now if DE, projection or map_b changed
+#endif
     ll2s (de_ll, de_c.s, DE_R);
     antipode (deap_ll, de_ll);
     ll2s (deap_ll, deap_c.s, DEAP_R);
@@ -234,6 +525,219 @@ void initEarthMap()
     // now main loop can resume with drawMoreEarth()
 }
 
+#if defined(_USE_DESKTOP)
+
+/* return how many map workers to use
+ */
+static int nMapWorkers()
+{
+    static int n;
+    if (n == 0) {
+        n = MAP_THREADS > 0 ? MAP_THREADS : sysconf (_SC_NPROCESSORS_ONLN);
+        if (n < 1)
+            n = 1;
+        Serial.printf ("Map workers: %d\n", n);
+    }
+    return (n);
+}
+
+/* fill mo with the current obstructions within map_b
+ */
+static void getMapObs (MapObs &mo)
+{
+    memset (&mo, 0, sizeof(mo));                // clean padding for memcmp
+    mo.rss_btn_b = rss_btn_b;
+    mo.rss_bnr_b = rss_bnr_b;
+    mo.azm_btn_b = azm_btn_b;
+    mo.llg_btn_b = llg_btn_b;
+    mo.rss_on = rss_on;
+}
+
+/* same as overMap() but using the obstructions in map_obs
+ */
+static bool overMapObs (const SCoord &s)
+{
+    const MapObs &mo = map_obs;
+    return (inBox (s, map_b) && !inBox (s, mo.rss_btn_b) && !(mo.rss_on && inBox (s, mo.rss_bnr_b))
+                        && !inBox (s, mo.azm_btn_b) && !inBox (s, mo.llg_btn_b));
+}
+
+/* thread to draw bands of map rows into the map layer until there are no more.
+ * arg is this worker's index into mapw_tiles.
+ * N.B. only reads map state, which is not changed until the sweep is over or stopMapWorkers()
+ */
+static void *mapWorker (void *arg)
+{
+    uint8_t *mtiles = &mapw_tiles[(intptr_t)arg * tft.mapLayerTiles()];
+    memset (mtiles, 0, tft.mapLayerTiles());
+
+    for (;;) {
+        int y0 = __sync_fetch_and_add (&mapw_next, MAPW_BAND);
+        if (y0 >= map_b.h || mapw_stop)
+            break;
+        int y1 = y0 + MAPW_BAND < map_b.h ? y0 + MAPW_BAND : map_b.h;
+        SCoord s;
+        for (s.y = map_b.y + y0; s.y < map_b.y + y1; s.y++) {
+            for (s.x = map_b.x; s.x < map_b.x + map_b.w; s.x++) {
+                if (!tft.mapLayerStale (s.x, s.y) || !overMapObs(s))
+                    continue;
+                MapLL m;
+                if (map_ll) {
+                    m = map_ll[(s.y - map_b.y)*map_b.w + (s.x - map_b.x)];
+                    if (isnan (m.ll.lat_d))
+                        continue;
+                } else if (!findMapLL (s, m))
+                    continue;
+                drawMapPixel (s, m, mtiles);
+            }
+        }
+    }
+
+    if (__sync_add_and_fetch (&mapw_done, 1) == mapw_n)
+        mapw_t1 = micros();
+    return (NULL);
+}
+
+/* wait for all map workers to finish, asking them to hurry if stop.
+ * the layer tiles they changed are then marked to be shown, even if stopped early, because the blocks
+ * they drew will not be drawn again until their shading changes.
+ */
+static void joinMapWorkers (bool stop)
+{
+    mapw_stop = stop;
+    for (int i = 0; i < mapw_n; i++) {
+        pthread_join (mapw_tids[i], NULL);
+        tft.markMapLayer (&mapw_tiles[i * tft.mapLayerTiles()]);
+    }
+    mapw_n = 0;
+    mapw_stop = false;
+}
+
+/* abandon any sweep in progress
+ */
+static void stopMapWorkers()
+{
+    joinMapWorkers (true);
+}
+
+/* after a desktop sweep, draw all symbols again if the new circumstances moved any.
+ */
+static void drawMovedSymbols()
+{
+    bool sat_now = isSatDefined();
+    if (!map_stamp_all && !sat_now && !map_stamp_sat && santa_b.x == 0
+                && !memcmp (&map_stamp_sun, &sun_c.s, sizeof(SCoord))
+                && !memcmp (&map_stamp_moon, &moon_c.s, sizeof(SCoord)))
+        return;
+
+    tft.eraseOverlay (map_b.x, map_b.y, map_b.w, map_b.h);
+    tft.beginBatch();
+    for (uint16_t y = map_b.y; y < map_b.y + map_b.h; y++) {
+        drawSatNameOnRow (y);
+        drawSatPointsOnRow (y);
+    }
+    tft.endBatch();
+    drawAllSymbols(false);
+
+    map_stamp_sun = sun_c.s;
+    map_stamp_moon = moon_c.s;
+    map_stamp_sat = sat_now;
+    map_stamp_all = false;
+}
+
+/* desktop map sweep in the background.
+ * start a sweep if none is in progress, or show the map when all workers have finished.
+ * return false if no memory so the caller should draw rows itself.
+ */
+static bool drawMoreEarthThreads()
+{
+    int n = nMapWorkers();
+
+    // start a sweep if none
+    if (mapw_n == 0) {
+
+        if (!mapw_tids) {
+            mapw_tids = (pthread_t *) malloc (n * sizeof(pthread_t));
+            mapw_tiles = (uint8_t *) malloc (n * tft.mapLayerTiles());
+            if (!mapw_tids || !mapw_tiles) {
+                free (mapw_tids);
+                free (mapw_tiles);
+                mapw_tids = NULL;
+                mapw_tiles = NULL;
+                return (false);
+            }
+        }
+
+        // insure the lookup table is current before the workers read it
+        checkMapLL();
+
+        // workers use a stable copy of the obstructions. the layer still holds map where any new ones
+        // are, which showMapLayer() would copy over them, so start afresh if they changed.
+        MapObs mo;
+        getMapObs (mo);
+        if (memcmp (&mo, &map_obs, sizeof(mo))) {
+            map_obs = mo;
+            map_layer_fresh = true;
+        }
+
+        if (!tft.openMapLayer (map_b.x, map_b.y, map_b.w, map_b.h, map_layer_fresh))
+            return (false);
+        map_layer_fresh = false;
+
+        // refresh circumstances at start of each map scan but not very first call after initEarthMap()
+        mapPerfStart();
+        if (moremap_s.x != 0)
+            updateCircumstances();
+        moremap_s.x = map_b.x;
+        mapPerfLap (MP_CIRCUMSTANCES, mp_t0);
+
+        mapw_next = 0;
+        mapw_done = 0;
+        for (mapw_n = 0; mapw_n < n; mapw_n++) {
+            int e = pthread_create (&mapw_tids[mapw_n], NULL, mapWorker, (void *)(intptr_t)mapw_n);
+            if (e) {
+                Serial.printf ("mapWorker: %s\n", strerror(e));
+                break;
+            }
+        }
+
+        // draw the map ourselves if could not start any
+        if (mapw_n == 0)
+            return (false);
+
+        return (true);
+    }
+
+    // wait for all to finish
+    if (mapw_done < mapw_n)
+        return (true);
+    joinMapWorkers (false);
+
+    // if the obstructions changed during the sweep the layer may have map where they are now, so
+    // leave the screen as is and draw the next sweep afresh
+    MapObs mo;
+    getMapObs (mo);
+    if (memcmp (&mo, &map_obs, sizeof(mo))) {
+        map_layer_fresh = true;
+        return (true);
+    }
+
+    // show the new map beneath the symbols
+    uint32_t t = mp_t0 + mp_sweep[MP_CIRCUMSTANCES];
+    mp_sweep[MP_RENDER] = mapw_t1 - t;
+    t = micros();
+    tft.showMapLayer (map_b.x, map_b.y, map_b.w, map_b.h);
+    t = mapPerfLap (MP_RENDER, t);
+    drawMovedSymbols();
+    mapPerfLap (MP_SYMBOLS, t);
+    tft.drawPR();
+    mapPerfDone();
+
+    return (true);
+}
+
+#endif // _USE_DESKTOP
+
 /* display more earth map at mmoremap_s.
  * _USE_DESKTOP draws all the map then all symbols then updates screen, but ESP has to take care not to
  *   clobber symbols while drawing the map.
@@ -245,9 +749,19 @@ void drawMoreEarth()
     // handy health indicator and update timer
     digitalWrite(LIFE_LED, !digitalRead(LIFE_LED));
 
+#if defined(_USE_DESKTOP)
+    // sweep in the background if we have the cores for it
+    if (drawMoreEarthThreads())
+        return;
+#endif
+
     // refresh circumstances at start of each map scan but not very first call after initEarthMap()
+    if (moremap_s.y == map_b.y)
+        mapPerfStart();
+    uint32_t t = micros();
     if (moremap_s.y == map_b.y && moremap_s.x != 0)
         updateCircumstances();
+    t = mapPerfLap (MP_CIRCUMSTANCES, t);
     
     // draw next row
     uint16_t last_x = map_b.x + EARTH_W*EARTH_XW - EARTH_XW;
@@ -257,6 +771,7 @@ void drawMoreEarth()
 
     // draw the entire map then overlay the symbols just before displaying
 
+    tft.beginBatch();
     for (moremap_s.x = map_b.x; moremap_s.x <= last_x; moremap_s.x += EARTH_XW) {
 
 	resetWatchdog();
@@ -264,6 +779,8 @@ void drawMoreEarth()
         drawMapCoord (moremap_s);
 
     }
+    tft.endBatch();
+    t = mapPerfLap (MP_RENDER, t);
 
 
 #else   // !defined(_USE_DESKTOP)
@@ -277,18 +794,25 @@ void drawMoreEarth()
     // preserve whether any symbols were found on this row for next time
     static uint8_t n_symbols_prev_row;
 
+    // only tiles marked in the occupancy masks need the exact symbol and obstruction tests
+    updateOccupancy();
+
     for (moremap_s.x = map_b.x; moremap_s.x <= last_x; moremap_s.x += 1) {
 
 	resetWatchdog();
 
         // test whether now over a symbol
-        bool over_symbol = overAnySymbol (moremap_s);
+        bool over_symbol = occupied (occ_sym, moremap_s) && overAnySymbol (moremap_s);
         n_symbols_this_row += over_symbol;
 
-        // draw map if not
-        if (!over_symbol)
-            drawMapCoord (moremap_s);
+        // draw map if not, unless under the RSS banner or a map button
+        if (!over_symbol && (!occupied (occ_obs, moremap_s) || overMap (moremap_s))) {
+            LatLong lls;
+            if (s2llGlobe (moremap_s, lls))
+                drawMapLL (moremap_s, lls);
+        }
     }
+    t = mapPerfLap (MP_RENDER, t);
 
     // draw all symbols if hit one on line above but none on this row
     if (n_symbols_this_row == 0 && n_symbols_prev_row > 0)
@@ -303,24 +827,19 @@ void drawMoreEarth()
     // check for clobbering sat path or name
     drawSatNameOnRow (moremap_s.y);
     drawSatPointsOnRow (moremap_s.y);
+    t = mapPerfLap (MP_SYMBOLS, t);
 
     // advance row, accounting for any row replication, and wrap at the end
     if ((moremap_s.y += EARTH_XH) >= map_b.y + EARTH_H*EARTH_XH) {
 	moremap_s.y = map_b.y;
 
 #if defined(_USE_DESKTOP)
-        drawAllSymbols(false);
+        drawMovedSymbols();
+        mapPerfLap (MP_SYMBOLS, t);
         tft.drawPR();
 #endif
 
-        // #define _TIME_MAP
-        #if defined(_TIME_MAP)
-            static uint32_t map_t0;
-            uint32_t map_t = millis();
-            if (map_t0 != 0)
-                Serial.printf ("Map paint %ld ms\n", map_t - map_t0);
-            map_t0 = map_t;
-        #endif
+        mapPerfDone();
     }
 }
 
@@ -406,6 +925,22 @@ bool s2ll (const SCoord &s, LatLong &ll)
     if (!overMap(s))
 	return (false);
 
+#if defined(_USE_DESKTOP)
+    const MapLL *mp = getMapLL (s);
+    if (!mp)
+        return (false);
+    ll = mp->ll;
+    return (true);
+#else
+    return (s2llGlobe (s, ll));
+#endif
+}
+
+/* convert a screen coord within map_b to lat and long regardless of what is drawn over the map.
+ * return whether location is really on the globe.
+ */
+static bool s2llGlobe (const SCoord &s, LatLong &ll)
+{
     if (azm_on) {
 
 	// radius from center of point's hemisphere
@@ -443,6 +978,112 @@ bool s2ll (const SCoord &s, LatLong &ll)
     return (true);
 }
 
+#if defined(_USE_DESKTOP)
+
+/* find m for screen coord s within map_b the hard way.
+ * return whether s is really on the globe.
+ */
+static bool findMapLL (const SCoord &s, MapLL &m)
+{
+    if (!s2llGlobe (s, m.ll))
+        return (false);
+
+    SCoord sr, sd;
+    LatLong llr, lld;
+    sr.x = s.x + 1;
+    sr.y = s.y;
+    if (sr.x >= map_b.x + map_b.w || !s2llGlobe (sr, llr))
+        llr = m.ll;
+    sd.x = s.x;
+    sd.y = s.y + 1;
+    if (sd.y >= map_b.y + map_b.h || !s2llGlobe (sd, lld))
+        lld = m.ll;
+    m.dlat_r = llr.lat_d - m.ll.lat_d;
+    m.dlng_r = llr.lng_d - m.ll.lng_d;
+    m.dlat_d = lld.lat_d - m.ll.lat_d;
+    m.dlng_d = lld.lng_d - m.ll.lng_d;
+
+    return (true);
+}
+
+/* (re)build map_ll for the current DE, projection and map_b.
+ * if no memory map_ll is left NULL and getMapLL() finds each location the hard way.
+ */
+static void initMapLL()
+{
+    // workers may be reading the old table, and every location is about to change
+    stopMapWorkers();
+    map_layer_fresh = true;
+
+    map_ll_de = de_ll;
+    map_ll_azm = azm_on;
+    map_ll_b = map_b;
+
+    // s2llGlobe() needs these, they may not be set yet for this DE
+    sdelat = sinf(de_ll.lat);
+    cdelat = cosf(de_ll.lat);
+
+    free (map_ll);
+    map_ll = (MapLL *) malloc (map_b.w * map_b.h * sizeof(MapLL));
+    if (!map_ll) {
+        Serial.println (F("map_ll malloc failed"));
+        return;
+    }
+
+    // find each location once
+    SCoord s;
+    MapLL *mp = map_ll;
+    for (s.y = map_b.y; s.y < map_b.y + map_b.h; s.y++) {
+        resetWatchdog();
+        for (s.x = map_b.x; s.x < map_b.x + map_b.w; s.x++, mp++)
+            if (!s2llGlobe (s, mp->ll))
+                mp->ll.lat_d = NAN;
+    }
+
+    // then the changes to each neighbor on the globe
+    for (int y = 0; y < map_b.h; y++) {
+        for (int x = 0; x < map_b.w; x++) {
+            mp = &map_ll[y*map_b.w + x];
+            if (isnan (mp->ll.lat_d))
+                continue;
+            const MapLL *rp = x < map_b.w-1 && !isnan (mp[1].ll.lat_d) ? &mp[1] : mp;
+            const MapLL *dp = y < map_b.h-1 && !isnan (mp[map_b.w].ll.lat_d) ? &mp[map_b.w] : mp;
+            mp->dlat_r = rp->ll.lat_d - mp->ll.lat_d;
+            mp->dlng_r = rp->ll.lng_d - mp->ll.lng_d;
+            mp->dlat_d = dp->ll.lat_d - mp->ll.lat_d;
+            mp->dlng_d = dp->ll.lng_d - mp->ll.lng_d;
+        }
+    }
+}
+
+/* rebuild map_ll if anything it depends on has changed.
+ */
+static void checkMapLL()
+{
+    if (azm_on != map_ll_azm || de_ll.lat != map_ll_de.lat || de_ll.lng != map_ll_de.lng
+                        || memcmp (&map_b, &map_ll_b, sizeof(map_b)) != 0)
+        initMapLL();
+}
+
+/* return the location info for screen coord s within map_b, or NULL if not on the globe.
+ * the table is rebuilt first if anything it depends on has changed.
+ * N.B. the result is only good until the next call
+ */
+static const MapLL *getMapLL (const SCoord &s)
+{
+    checkMapLL();
+
+    if (map_ll) {
+        const MapLL *mp = &map_ll[(s.y - map_b.y)*map_b.w + (s.x - map_b.x)];
+        return (isnan (mp->ll.lat_d) ? NULL : mp);
+    }
+
+    static MapLL m;
+    return (findMapLL (s, m) ? &m : NULL);
+}
+
+#endif // _USE_DESKTOP
+
 #if !defined(_USE_DESKTOP)
 
 /* given lat/lng and cos of angle from terminator, return earth map pixel
@@ -469,7 +1110,7 @@ static uint16_t getEarthMapPix (LatLong ll, float cos_t)
         uint8_t night_r = RGB565_R(night_pix);
         uint8_t night_g = RGB565_G(night_pix);
         uint8_t night_b = RGB565_B(night_pix);
-        float fract_night = powf(cos_t/GRAYLINE_COS, GRAYLINE_POW);
+        float fract_night = fractNight (cos_t);
         float fract_day = 1 - fract_night;
         uint8_t twi_r = (fract_day*day_r + fract_night*night_r);
         uint8_t twi_g = (fract_day*day_g + fract_night*night_g);
@@ -485,6 +1126,87 @@ static uint16_t getEarthMapPix (LatLong ll, float cos_t)
 
 #endif
 
+// grid colors
+#define GRIDC   RGB565(35,35,35)
+#define GRIDC00 RGB565(120,120,120)
+
+#if defined(_USE_DESKTOP)
+
+/* draw one application pixel s at full screen resolution given its lat/lng and the changes to the
+ * points one step right and down. these are used by plotEarth to interpolate to full map resolution.
+ * draw into the map layer, marking the tiles changed in mtiles, if given, else directly onto the screen.
+ *   s - - - r
+ *   |
+ *   d
+ */
+static void drawMapPixel (const SCoord &s, const MapLL &m, uint8_t *mtiles)
+{
+    const LatLong &lls = m.ll;
+
+    // draw the full res map point, shaded at each point for the sun given in updateCircumstances().
+    // the layer already has this point along with any grid if its shading has not changed.
+    // mtiles is given when drawing into the layer.
+    bool layer = mtiles != NULL;
+    if (layer) {
+        if (!tft.plotEarthLayer (s.x, s.y, lls.lat_d, lls.lng_d, m.dlat_r, m.dlng_r, m.dlat_d, m.dlng_d, mtiles))
+            return;
+    } else
+        tft.plotEarth (s.x, s.y, lls.lat_d, lls.lng_d, m.dlat_r, m.dlng_r, m.dlat_d, m.dlng_d);
+
+    // overlay lat/long grid if enabled
+    #define DLAT        (0.98F*180.0F/(EARTH_H*EARTH_XH))                        // about 1 pixel
+    #define DLNG        (0.98F*360.0F/(EARTH_W*EARTH_XW)/(azm_on ? cosf(lls.lat) : 1)) // " with polar spread
+    switch (llg_on) {
+    case LLG_ALL:
+
+        if (myfmodf (lls.lat_d+90, 15) < DLAT || myfmodf (lls.lng_d+180, 15) < DLNG) {
+            uint32_t grid_c = (fabsf (lls.lat_d) < DLAT || fabs (lls.lng_d) < DLNG) ? GRIDC00 : GRIDC;
+            if (layer)
+                tft.drawLayerPixel (s.x, s.y, grid_c);
+            else
+                tft.drawPixel (s.x, s.y, grid_c);
+        }
+        break;
+
+    case LLG_TROPICS:
+
+        if (fabsf (fabsf (lls.lat_d) - 23.5F) < DLAT/2) {
+            if (layer)
+                tft.drawLayerPixel (s.x, s.y, GRIDC00);
+            else
+                tft.drawPixel (s.x, s.y, GRIDC00);
+        }
+        break;
+
+    default:
+        // none
+        break;
+
+    }
+    #undef DLAT
+    #undef DLNG
+}
+
+#endif // _USE_DESKTOP
+
+/* restore the w map locations starting at x,y going right by erasing any symbols drawn over them.
+ * desktops draw symbols in the overlay so need only erase that, others draw the map again with
+ * drawMapCoord(), skipping any not over the map.
+ */
+void eraseMapSpan (uint16_t x, uint16_t y, uint16_t w)
+{
+    #if defined(_USE_DESKTOP)
+
+        tft.eraseOverlay (x, y, w, 1);
+
+    #else // !defined(_USE_DESKTOP)
+
+        for (uint16_t i = 0; i < w; i++)
+            drawMapCoord (x + i, y);
+
+    #endif // defined(_USE_DESKTOP)
+}
+
 /* draw EARTH_XWxEARTH_XH at the given screen location, if it's over the map.
  * We are called for every value of x but for the low-res ESP map we duplicate the odd values.
  */
@@ -498,10 +1220,6 @@ void drawMapCoord (uint16_t x, uint16_t y)
 }
 void drawMapCoord (const SCoord &s)
 {
-    // grid colors
-    #define GRIDC   RGB565(35,35,35)
-    #define GRIDC00 RGB565(120,120,120)
-
 
     #if defined(_USE_DESKTOP)
 
@@ -513,74 +1231,14 @@ void drawMapCoord (const SCoord &s)
             #error unsupported earth map DESKTOP resolution
         #endif
 
-        // find lat/lng at this screen location, bale if not over map
-        LatLong lls;
-        if (!s2ll(s,lls))
-            return; 
-
-        /* even though we only draw one application point, s, plotEarth needs points r and d to
-         * interpolate to full map resolution.
-         *   s - - - r
-         *   |
-         *   d
-         */
-        SCoord sr, sd;
-        LatLong llr, lld;
-        sr.x = s.x + 1;
-        sr.y = s.y;
-        if (!s2ll(sr,llr))
-            llr = lls;
-        sd.x = s.x;
-        sd.y = s.y + 1;
-        if (!s2ll(sd,lld))
-            lld = lls;
-
-        // find angle between subsolar point and any visible near this location
-        // TODO: actually different at each point, this causes striping
-        float clat = cosf(lls.lat);
-        float slat = sinf(lls.lat);
-        float cos_t = ssslat*slat + csslat*clat*cosf(sun_ss_ll.lng-lls.lng);
-
-        // decide day, night or twilight
-        float fract_day;
-        if (cos_t > 0) {
-            // < 90 deg: sunlit
-            fract_day = 1;
-        } else if (cos_t > GRAYLINE_COS) {
-            // blend from day to night
-            fract_day = 1 - powf(cos_t/GRAYLINE_COS, GRAYLINE_POW);
-        } else {
-            // night side
-            fract_day = 0;
-        }
-
-        // draw the full res map point
-        tft.plotEarth (s.x, s.y, lls.lat_d, lls.lng_d, llr.lat_d - lls.lat_d, llr.lng_d - lls.lng_d,
-                    lld.lat_d - lls.lat_d, lld.lng_d - lls.lng_d, fract_day);
-
-        // overlay lat/long grid if enabled
-        #define DLAT        (0.98F*180.0F/(EARTH_H*EARTH_XH))                        // about 1 pixel
-        #define DLNG        (0.98F*360.0F/(EARTH_W*EARTH_XW)/(azm_on ? clat : 1))    // " with polar spread
-        switch (llg_on) {
-        case LLG_ALL:
-
-            if (myfmodf (lls.lat_d+90, 15) < DLAT || myfmodf (lls.lng_d+180, 15) < DLNG) {
-                uint32_t grid_c = (fabsf (lls.lat_d) < DLAT || fabs (lls.lng_d) < DLNG) ? GRIDC00 : GRIDC;
-                tft.drawPixel (s.x, s.y, grid_c);
-            }
-            break;
-
-        case LLG_TROPICS:
-
-            if (fabsf (fabsf (lls.lat_d) - 23.5F) < DLAT/2) 
-                tft.drawPixel (s.x, s.y, GRIDC00);
-            break;
-
-        default:
-            // none
-            break;
+        // look up lat/lng and its gradients at this screen location, bale if not over map
+        if (!overMap(s))
+            return;
+        const MapLL *mp = getMapLL (s);
+        if (!mp)
+            return;
 
-        }
+        drawMapPixel (s, *mp, NULL);
 
 
     #else // !defined(_USE_DESKTOP)
@@ -592,101 +1250,108 @@ void drawMapCoord (const SCoord &s)
         #endif
 
         // draw one pixel, if over map
+        LatLong lls;
+        if (s2ll(s, lls))
+            drawMapLL (s, lls);
 
-        // a latitude cache really helps Mercator time; anything help Azimuthal??
-        static float slat_c, clat_c;
-        static SCoord s_c;
+    #endif  // defined _USE_DESKTOP
 
-        // find lat/lng at this screen location, done if not over map
-        LatLong lls;
-        if (!s2ll(s, lls))
-            return;
+}
 
-        // update handy Mercator cache, but always required for Azm.
-        if (azm_on || s.y != s_c.y) {
-            s_c = s;
-            slat_c = sinf(lls.lat);
-            clat_c = cosf(lls.lat);
-        }
+#if !defined(_USE_DESKTOP)
 
-        // draw lat/long grid if enabled
-        #define DLAT        0.6F
-        #define DLNG        (0.5F/clat_c)
-        switch (llg_on) {
-        case LLG_ALL:
-
-            if (azm_on) {
-
-                if (myfmodf(lls.lat_d+90, 15) < DLAT || myfmodf (lls.lng_d+180, 15) < DLNG) {
-                    uint32_t grid_c = (fabsf (lls.lat_d) < DLAT || fabs (lls.lng_d) < DLNG) ? GRIDC00 : GRIDC;
-                    tft.drawPixel (s.x, s.y, grid_c);
-                    return;                                         // done
-                }
-
-            } else {
-
-                // extra gymnastics are because the pixels-per-line are not integral
-                #define _PPLG (EARTH_W*EARTH_XW/(360/15))
-                #define _PPLN (EARTH_H*EARTH_XH/(180/15))
-                if ((((s.x - map_b.x) - (s.x - map_b.x)/(2*_PPLG)) % _PPLG) == 0
-                                    || (((s.y - map_b.y) - (s.y - map_b.y)/(2*_PPLN)) % _PPLN) == 0) {
-                    uint32_t grid_c = (fabsf (lls.lat_d) < DLAT || fabs (lls.lng_d) < DLNG) ? GRIDC00 : GRIDC;
-                    tft.drawPixel (s.x, s.y, grid_c);
-                    return;                                         // done
-                }
-            }
+/* draw the ESP map pixel at s, known to be over the map at lls.
+ */
+static void drawMapLL (const SCoord &s, const LatLong &lls)
+{
+    // a latitude cache really helps Mercator time; anything help Azimuthal??
+    static float slat_c, clat_c;
+    static SCoord s_c;
 
-            break;
+    // update handy Mercator cache, but always required for Azm.
+    if (azm_on || s.y != s_c.y) {
+        s_c = s;
+        slat_c = sinf(lls.lat);
+        clat_c = cosf(lls.lat);
+    }
 
-        case LLG_TROPICS:
+    // draw lat/long grid if enabled
+    #define DLAT        0.6F
+    #define DLNG        (0.5F/clat_c)
+    switch (llg_on) {
+    case LLG_ALL:
 
-            if (azm_on) {
+        if (azm_on) {
 
-                if (fabsf (fabsf (lls.lat_d) - 23.5F) < 0.3F) {
-                    tft.drawPixel (s.x, s.y, GRIDC00);
-                    return;                                         // done
-                }
+            if (myfmodf(lls.lat_d+90, 15) < DLAT || myfmodf (lls.lng_d+180, 15) < DLNG) {
+                uint32_t grid_c = (fabsf (lls.lat_d) < DLAT || fabs (lls.lng_d) < DLNG) ? GRIDC00 : GRIDC;
+                tft.drawPixel (s.x, s.y, grid_c);
+                return;                                             // done
+            }
 
-            } else {
+        } else {
 
-                // we already know exactly where the grid lines go.
-                if (abs(s.y - (map_b.y+EARTH_H*EARTH_XH/2)) == (uint16_t)((23.5F/180)*(EARTH_H*EARTH_XH))) {
-                    tft.drawPixel (s.x, s.y, GRIDC00);
-                    return;                                         // done
-                }
+            // extra gymnastics are because the pixels-per-line are not integral
+            #define _PPLG (EARTH_W*EARTH_XW/(360/15))
+            #define _PPLN (EARTH_H*EARTH_XH/(180/15))
+            if ((((s.x - map_b.x) - (s.x - map_b.x)/(2*_PPLG)) % _PPLG) == 0
+                                || (((s.y - map_b.y) - (s.y - map_b.y)/(2*_PPLN)) % _PPLN) == 0) {
+                uint32_t grid_c = (fabsf (lls.lat_d) < DLAT || fabs (lls.lng_d) < DLNG) ? GRIDC00 : GRIDC;
+                tft.drawPixel (s.x, s.y, grid_c);
+                return;                                             // done
             }
-            break;
+        }
 
-        default:
+        break;
 
-            // none
-            break;
+    case LLG_TROPICS:
 
-        }
+        if (azm_on) {
 
-        // if get here we did not draw a lat/long grid point
+            if (fabsf (fabsf (lls.lat_d) - 23.5F) < 0.3F) {
+                tft.drawPixel (s.x, s.y, GRIDC00);
+                return;                                             // done
+            }
 
-        // we know it's the same color if Mercator and x is one to the right of previous
-        static uint16_t prev_clr;
-        if (!azm_on && s.y == s_c.y && s.x == s_c.x + 1) {
-            tft.drawPixel (s.x, s.y, prev_clr);
-            return;
+        } else {
+
+            // we already know exactly where the grid lines go.
+            if (abs(s.y - (map_b.y+EARTH_H*EARTH_XH/2)) == (uint16_t)((23.5F/180)*(EARTH_H*EARTH_XH))) {
+                tft.drawPixel (s.x, s.y, GRIDC00);
+                return;                                             // done
+            }
         }
+        break;
 
-        // find angle between subsolar point and this location
-        float cos_t = ssslat*slat_c + csslat*clat_c*cosf(sun_ss_ll.lng-lls.lng);
+    default:
 
-        uint16_t pix_c = getEarthMapPix (lls, cos_t);
-        tft.drawPixel (s.x, s.y, pix_c);
+        // none
+        break;
 
-        // preserve for next call
-        s_c = s;
-        prev_clr = pix_c;
+    }
 
-    #endif  // defined _USE_DESKTOP
+    // if get here we did not draw a lat/long grid point
+
+    // we know it's the same color if Mercator and x is one to the right of previous
+    static uint16_t prev_clr;
+    if (!azm_on && s.y == s_c.y && s.x == s_c.x + 1) {
+        tft.drawPixel (s.x, s.y, prev_clr);
+        return;
+    }
+
+    // find angle between subsolar point and this location
+    float cos_t = ssslat*slat_c + csslat*clat_c*cosf(sun_ss_ll.lng-lls.lng);
 
+    uint16_t pix_c = getEarthMapPix (lls, cos_t);
+    tft.drawPixel (s.x, s.y, pix_c);
+
+    // preserve for next call
+    s_c = s;
+    prev_clr = pix_c;
 }
 
+#endif  // !_USE_DESKTOP
+
 /* draw sun symbol.
  * N.B. we assume sun_c coords insure marker will be wholy within map boundaries.
  */
@@ -696,6 +1361,7 @@ void drawSun ()
 
 #   define	N_SUN_RAYS	12
     uint16_t body_r = 5*SUN_R/9;
+    tft.beginOverlay();
     tft.fillCircle (sun_c.s.x, sun_c.s.y, SUN_R, RA8875_BLACK);
     tft.fillCircle (sun_c.s.x, sun_c.s.y, body_r, RA8875_YELLOW);
     for (uint8_t i = 0; i < N_SUN_RAYS; i++) {
@@ -708,6 +1374,7 @@ void drawSun ()
 	uint16_t y1 = sun_c.s.y + (SUN_R)*sa + 0.5F;
 	tft.drawLine (x0, y0, x1, y1, RA8875_YELLOW);
     }
+    tft.endOverlay();
 #   undef N_SUN_RAYS
 }
 
@@ -728,6 +1395,8 @@ void drawMoon ()
 
     // scan moon face @ full SCALESZ
     const uint16_t mr = MOON_R*tft.SCALESZ;		// moon radius on output device
+    tft.beginBatch();
+    tft.beginOverlay();
     for (int16_t dy = -mr; dy <= mr; dy++) {            // scan top to bottom
 	float Ry = sqrtf(mr*mr-dy*dy);		        // half-width at y
 	int16_t Ryi = floorf(Ry+0.5F);			// " as int
@@ -738,6 +1407,8 @@ void drawMoon ()
 		    	? RA8875_BLACK : RA8875_WHITE);
 	}
     }
+    tft.endOverlay();
+    tft.endBatch();
 
 #else // !defined(_USE_DESKTOP)
 
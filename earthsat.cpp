@@ -12,11 +12,11 @@ bool dx_info_for_sat;			// global to indicate whether dx_info_b is for DX info o
 
 #define	MAX_TLE_AGE	7.0F		// max age to use a TLE, days (except moon)
 #define SAT_MIN_EL      1.0F            // minimum sat elevation for event
-#define	TLE_REFRESH	(3600*6)	// freshen TLEs this often, seconds
 #define	SAT_TOUCH_R	20U		// touch radius, pixels
 #define	SAT_UP_R	2		// dot radius when up
 #define	PASS_STEP	10.0F           // pass step size, seconds
 #define MAX_PATH	2000		// max number of points in orbit path
+#define PATH_BATCH	50		// orbit path points computed per predictMany()
 #define	MAX_FOOT	1625		// max number of points in viewing footprint; must be 13*
 #define	TBORDER		50		// top border
 #define	FONT_H		(dx_info_b.h/6)	// font height
@@ -36,8 +36,18 @@ bool dx_info_for_sat;			// global to indicate whether dx_info_b is for DX info o
 #define	N_ROWS		((tft.height()-TBORDER)/CELL_H)	        // n rows in name table
 #define	MAX_NSAT	(N_ROWS*N_COLS)				// max names we can display
 #define MAX_PASS_STEPS  30              // max lines to draw for pass map
-
-static const char sat_get_all[] = "/ham/HamClock/esats.pl?getall=";	// command to get all TLE
+#define PASS_START      2.0F            // start pass search this long after now, seconds
+#define PASS_SEARCH     (2.0F*SPD)      // search this far ahead for rise and set, seconds
+#define PASS_MINDT      20.0F           // shortest search step, seconds
+#define PASS_MAXDT      (6*3600.0F)     // longest search step, seconds
+#define PASS_TOL        0.5F            // rise and set time tolerance, seconds
+#define MAXEL_TOL       5.0F            // max el time tolerance, seconds
+#define MAXEL_N         6               // n coarse samples to find max el
+#define PASS_ELMARGIN   1.0F            // SAT_MIN_EL allowance for refraction and geodetic zenith, degrees
+#define EARTH_ROT       7.292e-5F       // earth rotation rate, rads/sec
+#define EARTH_MU        398600.4F       // earth gravitational parameter, km^3/sec^2
+
+const char sat_get_all[] = "/ham/HamClock/esats.pl?getall=";		// command to get all TLE
 static const char sat_one_page[] = "/ham/HamClock/esats.pl?tlename=%s";	// command to get one TLE
 static Satellite *sat;			// satellite definition, if any
 static Observer *obs;			// DE
@@ -45,9 +55,19 @@ static DateTime rise_time, set_time;	// next pass info
 static bool rise_ok, set_ok;		// whether rise_time and set_time are valid
 static float rise_az, set_az;           // rise and set az, degrees, if valid
 static bool ever_up, ever_down;         // whether sat is ever above or below SAT_MIN_EL in next day
-static SCoord *sat_path;		// mallocd screen coords for orbit, first always now, Moon only 1
+static DateTime max_time;               // time of max el of pass in progress else next pass
+static float max_el, max_az;            // max el and its az, degrees, if max_ok
+static bool max_ok;                     // whether max_time et al are valid
+static SCoord *sat_path;		// mallocd ring of screen coords for orbit, [path_head] always now, Moon only 1
+static SCoord *sat_pts;                 // mallocd sat_path[] from now on without repeats, for drawing
 static SCoord *sat_foot;		// mallocd screen coords for footprint
-static uint16_t n_path, n_foot;		// actual number in use
+static uint16_t n_path, n_pts, n_foot;	// actual number in use
+static uint16_t path_head;              // sat_path[] index of now
+static DateTime path_t0;                // sat_path[] samples are at path_t0 + k*period/MAX_PATH ...
+static long path_k0;                    // ... with k = path_k0 at path_head
+static bool path_azm;                   // azm_on when sat_path[] was projected
+static LatLong path_de;                 // de_ll when sat_path[] was projected
+static SBox path_map_b;                 // map_b when sat_path[] was projected
 static SBox map_name_b;		        // location of sat name on map
 static SBox ok_b = {730,10,55,35};	// Ok button
 static char sat_name[NV_SATNAME_LEN];	// NV_SATNAME cache (spaces are underscores)
@@ -55,6 +75,14 @@ static char sat_name[NV_SATNAME_LEN];	// NV_SATNAME cache (spaces are underscore
 static time_t tle_refresh;		// last TLE update
 static bool new_pass;                   // set when new pass is ready
 
+/* mark the orbit path as needing to be found again from scratch, such as for a new sat
+ */
+static void resetSatPath()
+{
+    n_path = 0;
+    n_pts = 0;
+}
+
 /* completely undefine the current sat
  */
 static void unsetSat()
@@ -67,10 +95,16 @@ static void unsetSat()
         free (sat_path);
         sat_path = NULL;
     }
+    if (sat_pts) {
+        free (sat_pts);
+        sat_pts = NULL;
+    }
     if (sat_foot) {
         free (sat_foot);
         sat_foot = NULL;
     }
+    resetSatPath();
+    n_foot = 0;
     sat_name[0] = '\0';
     NVWriteString (NV_SATNAME, sat_name);
     dx_info_for_sat = false;
@@ -89,7 +123,6 @@ static void strncpySubChar (char to_str[], const char from_str[], char to_char,
 }
 
 /* fill sat_foot with loci of points that see the sat at various viewing altitudes.
- * N.B. call this before updateSatPath malloc's its memory
  */
 static void updateFootPrint (float satlat, float satlng)
 {
@@ -147,6 +180,37 @@ static void updateFootPrint (float satlat, float satlng)
     }
 }
 
+/* copy sat_path[] from now on into sat_pts[], skipping points repeated on the same pixel.
+ * many consecutive ring points land on the same pixel so this is much shorter to scan for each row.
+ */
+static void updateSatPoints()
+{
+    // count first so sat_pts need only be resized when the count changes
+    uint16_t n = 0;
+    SCoord prev = {0, 0};
+    for (uint16_t p = 0, i = path_head; p < n_path; p++, i = i+1 < MAX_PATH ? i+1 : 0) {
+        SCoord s = sat_path[i];
+        if (p == 0 || s.x != prev.x || s.y != prev.y)
+            n++;
+        prev = s;
+    }
+
+    if (n != n_pts || !sat_pts) {
+        sat_pts = (SCoord *) realloc (sat_pts, n*sizeof(SCoord));
+        if (!sat_pts) {
+            Serial.println (F("Failed to realloc sat_pts"));
+            while (1);	// timeout
+        }
+    }
+
+    n_pts = 0;
+    for (uint16_t p = 0, i = path_head; p < n_path; p++, i = i+1 < MAX_PATH ? i+1 : 0) {
+        SCoord s = sat_path[i];
+        if (n_pts == 0 || s.x != sat_pts[n_pts-1].x || s.y != sat_pts[n_pts-1].y)
+            sat_pts[n_pts++] = s;
+    }
+}
+
 /* return a DateTime for the user's notion of current time
  */
 static DateTime userNow()
@@ -164,101 +228,293 @@ static DateTime userNow()
     return (dt);
 }
 
-/* find next rise and set times if sat valid.
- * always find rise and set in the future, so set_time will be < rise_time iff pass is in progress.
- * also update flags ever_up, set_ok, ever_down and rise_ok.
+// state of one findSatPass() search
+typedef struct {
+    Satellite *sp;                      // sat being searched, changed by each prediction
+    const Observer *op;                 // observer
+    DateTime t0;                        // search times are seconds after this
+    int n;                              // n predictions so far
+} PassCtx;
+
+/* find el and az of pc.sp at pc.t0 + secs, degrees.
+ * if dtp also return how many seconds el is sure to stay on the same side of SAT_MIN_EL, the larger
+ * of two bounds using the perigee and apogee radii from the current state vector:
+ *   el: moving d km from range R turns the line of sight no more than asin(d/R) < pi/2*d/R,
+ *       with the sat no faster than at perigee, plus the rotation of the sky;
+ *   zenith angle: the sat must get within the earth-centered cap visible above SAT_MIN_EL from apogee
+ *       (or leave the one from perigee) and its direction turns no faster than at perigee plus the
+ *       earth rotation.
+ * PASS_ELMARGIN allows for refraction and the geodetic zenith.
  */
-static void findNextPass(char *name)
+static float passEl (PassCtx &pc, float secs, float *azp, float *dtp)
 {
-    if (!sat || !obs) {
-	set_ok = rise_ok = false;
-	return;
-    }
+    Satellite *sp = pc.sp;
+    const Observer *op = pc.op;
+    float el, az, range, rate;
+    DateTime t = pc.t0;
+    t += secs/SPD;
+    sp->predict (t);
+    sp->topo (op, el, az, range, rate);
+    pc.n++;
+
+    if (azp)
+        *azp = az;
+
+    if (dtp) {
+        const float *S = sp->S, *V = sp->V;
+        float r = sqrtf (S[0]*S[0] + S[1]*S[1] + S[2]*S[2]);
+        float r0 = sqrtf (op->O[0]*op->O[0] + op->O[1]*op->O[1] + op->O[2]*op->O[2]);
+        float v2 = V[0]*V[0] + V[1]*V[1] + V[2]*V[2];
+        float hx = S[1]*V[2] - S[2]*V[1], hy = S[2]*V[0] - S[0]*V[2], hz = S[0]*V[1] - S[1]*V[0];
+        float h = sqrtf (hx*hx + hy*hy + hz*hz);
+        float en = v2/2 - EARTH_MU/r;
+        if (en >= 0 || h == 0) {
+            *dtp = PASS_MINDT;                          // not bound, play safe
+        } else {
+            float a = -EARTH_MU/(2*en);
+            float ecc = sqrtf (fmaxf (0, 1 + 2*en*h*h/(EARTH_MU*EARTH_MU)));
+            float rp = fmaxf (a*(1-ecc), r0 + 1);
+            float ra = a*(1+ecc);
+            bool up = el >= SAT_MIN_EL;
 
-    // measure how long this takes
-    uint32_t t0 = millis();
+            float e_lo = deg2rad (SAT_MIN_EL - PASS_ELMARGIN), e_hi = deg2rad (SAT_MIN_EL + PASS_ELMARGIN);
+            float v = h/rp + sqrtf (op->V[0]*op->V[0] + op->V[1]*op->V[1]);
+            float dt_el = fminf (range/v, fabsf (deg2rad (el - SAT_MIN_EL))/(1.5708F*v/range + EARTH_ROT));
 
-    #define COARSE_DT	90L		// seconds/step forward for fast search
-    #define FINE_DT  	(-2L)		// seconds/step backward for refined search
-    float pel;				// previous elevation
-    long dt = COARSE_DT;		// search time step size, seconds
-    DateTime t_now = userNow();		// user's display time
-    DateTime t_srch = t_now + -FINE_DT;	// search time, start beyond any previous solution
-    float tel, taz, trange, trate;	// target el and az, degrees
+            float zen = acosf (fmaxf (-1, fminf (1, (S[0]*op->U[0] + S[1]*op->U[1] + S[2]*op->U[2])/r)));
+            float cap = up ? acosf (r0/rp*cosf(e_hi)) - e_hi : acosf (r0/ra*cosf(e_lo)) - e_lo;
+            float dt_zen = fmaxf (0, up ? cap - zen : zen - cap)/(h/(rp*rp) + EARTH_ROT);
 
-    // init pel and make first step
-    sat->predict (t_srch);
-    sat->topo (obs, pel, taz, trange, trate);
-    t_srch += dt;
+            *dtp = fmaxf (dt_el, dt_zen);
+        }
+    }
 
-    // search up to a few days ahead for next rise and set times (for example for moon)
-    set_ok = rise_ok = false;
-    ever_up = ever_down = false;
-    while ((!set_ok || !rise_ok) && t_srch < t_now + 2.0F) {
-	resetWatchdog();
+    return (el);
+}
 
-	// find circumstances at time t_srch
-	sat->predict (t_srch);
-	sat->topo (obs, tel, taz, trange, trate);
-
-	// check for rising or setting events
-	if (tel >= SAT_MIN_EL) {
-            ever_up = true;
-            if (pel < SAT_MIN_EL) {
-                if (dt == FINE_DT) {
-                    // found a refined set event (recall we are going backwards),
-                    // record and resume forward time.
-                    set_time = t_srch;
-                    set_az = taz;
-                    set_ok = true;
-                    dt = COARSE_DT;
-                    pel = tel;
-                } else if (!rise_ok) {
-                    // found a coarse rise event, go back slower looking for better set
-                    dt = FINE_DT;
-                    pel = tel;
-                }
+/* el above SAT_MIN_EL at pc.t0 + secs, degrees
+ */
+static float passElErr (PassCtx &pc, float secs)
+{
+    return (passEl (pc, secs, NULL, NULL) - SAT_MIN_EL);
+}
+
+/* given passElErr() at a and b of opposite sign return secs after pc.t0 within PASS_TOL where it
+ * crosses zero. Brent's method: inverse quadratic or secant steps when they behave, else bisection.
+ */
+static float passRoot (PassCtx &pc, float a, float fa, float b, float fb)
+{
+    float c = b, fc = fb, d = b - a, e = d;
+
+    for (int iter = 0; iter < 50; iter++) {
+        if ((fb > 0) == (fc > 0)) {
+            // keep root between b and c
+            c = a;
+            fc = fa;
+            d = e = b - a;
+        }
+        if (fabsf(fc) < fabsf(fb)) {
+            // b is best so far
+            a = b; b = c; c = a;
+            fa = fb; fb = fc; fc = fa;
+        }
+        float m = (c - b)/2;
+        if (fabsf(m) <= PASS_TOL || fb == 0)
+            return (b);
+        if (fabsf(e) >= PASS_TOL && fabsf(fa) > fabsf(fb)) {
+            // try interpolating
+            float p, q, s = fb/fa;
+            if (a == c) {
+                p = 2*m*s;
+                q = 1 - s;
+            } else {
+                float r = fb/fc;
+                q = fa/fc;
+                p = s*(2*m*q*(q - r) - (b - a)*(r - 1));
+                q = (q - 1)*(r - 1)*(s - 1);
             }
-	} else {
-            ever_down = true;
-            if (pel > SAT_MIN_EL) {
-                if (dt == FINE_DT) {
-                    // found a refined rise event (recall we are going backwards).
-                    // record and resume forward time but skip if set is within COARSE_DT because we
-                    // would jump over it and find the NEXT set.
-                    float check_tel, check_taz;
-                    DateTime check_set = t_srch + COARSE_DT;
-                    sat->predict (check_set);
-                    sat->topo (obs, check_tel, check_taz, trange, trate);
-                    if (check_tel >= SAT_MIN_EL) {
-                        rise_time = t_srch;
-                        rise_az = taz;
-                        rise_ok = true;
-                    }
-                    // regardless, resume forward search
-                    dt = COARSE_DT;
-                    pel = tel;
-                } else if (!set_ok) {
-                    // found a coarse set event, go back slower looking for better rise
-                    dt = FINE_DT;
-                    pel = tel;
+            if (p > 0)
+                q = -q;
+            else
+                p = -p;
+            if (2*p < fminf (3*m*q - fabsf(PASS_TOL*q), fabsf(e*q))) {
+                e = d;
+                d = p/q;
+            } else {
+                d = m;
+                e = d;
+            }
+        } else {
+            d = m;
+            e = d;
+        }
+        a = b;
+        fa = fb;
+        b += fabsf(d) > PASS_TOL ? d : (m > 0 ? PASS_TOL : -PASS_TOL);
+        fb = passElErr (pc, b);
+    }
+
+    return (b);
+}
+
+/* find the time, el and az of max elevation of the pass from pc.t0 + s0 to pc.t0 + s1 into pass.
+ * sample the pass coarsely then narrow in on the highest sample by golden section search.
+ * N.B. closest approach is not good enough for eccentric orbits.
+ */
+static void findMaxEl (PassCtx &pc, float s0, float s1, SatPass &pass)
+{
+    float ds = (s1 - s0)/(MAXEL_N-1);
+    float smax = s0, emax = -90;
+    for (int i = 0; i < MAXEL_N; i++) {
+        float s = s0 + i*ds;
+        float e = passEl (pc, s, NULL, NULL);
+        if (e > emax) {
+            emax = e;
+            smax = s;
+        }
+    }
+
+    // golden section search around smax
+    const float g = 0.381966F;                          // 2 - golden ratio
+    float a = fmaxf (s0, smax - ds), b = fminf (s1, smax + ds);
+    float x1 = a + g*(b - a), x2 = b - g*(b - a);
+    float e1 = passEl (pc, x1, NULL, NULL), e2 = passEl (pc, x2, NULL, NULL);
+    while (b - a > MAXEL_TOL) {
+        if (e1 > e2) {
+            b = x2;
+            x2 = x1;
+            e2 = e1;
+            x1 = a + g*(b - a);
+            e1 = passEl (pc, x1, NULL, NULL);
+        } else {
+            a = x1;
+            x1 = x2;
+            e1 = e2;
+            x2 = b - g*(b - a);
+            e2 = passEl (pc, x2, NULL, NULL);
+        }
+    }
+    float s = e1 > e2 ? x1 : x2;
+    if (fmaxf (e1, e2) < emax)
+        s = smax;                                       // search did no better than the samples
+
+    pass.max_time = pc.t0;
+    pass.max_time += s/SPD;
+    pass.max_el = passEl (pc, s, &pass.max_az, NULL);
+    pass.max_ok = true;
+}
+
+/* search for the next rise and set of sp as seen from op for up to max_s seconds after t0.
+ * rise and set are always after t0, so set_time will be < rise_time iff pass is in progress.
+ * also find max_time, max_el and max_az for the pass in progress or else the next pass.
+ * return the number of predictions this took.
+ * N.B. only changes *sp and pass so may be used for different sats at once.
+ *
+ * we step forward as far as passEl() says el can not cross SAT_MIN_EL, so steps are long while the
+ * sat is far away or low and short only near a crossing, then refine each crossing with passRoot().
+ */
+int findSatPass (Satellite *sp, const Observer *op, const DateTime &t0, float max_s, SatPass &pass)
+{
+    PassCtx pc = {sp, op, t0, 0};
+
+    // init at start of search, beyond any previous solution
+    float s0 = PASS_START;		// search time, seconds after t0
+    float dt;				// time el surely stays on the same side of SAT_MIN_EL
+    float el0 = passEl (pc, s0, NULL, &dt) - SAT_MIN_EL;
+
+    pass.set_ok = pass.rise_ok = pass.max_ok = false;
+    pass.ever_up = pass.ever_down = false;
+    while ((!pass.set_ok || !pass.rise_ok) && s0 < max_s) {
+
+        if (el0 >= 0)
+            pass.ever_up = true;
+        else
+            pass.ever_down = true;
+
+        // step as far as el can not cross SAT_MIN_EL
+        if (dt < PASS_MINDT)
+            dt = PASS_MINDT;
+        else if (dt > PASS_MAXDT)
+            dt = PASS_MAXDT;
+        float s1 = s0 + dt;
+        float el1 = passEl (pc, s1, NULL, &dt) - SAT_MIN_EL;
+
+        // refine if crossed
+        if ((el0 >= 0) != (el1 >= 0)) {
+            float s = passRoot (pc, s0, el0, s1, el1);
+            float az;
+            (void) passEl (pc, s, &az, NULL);
+            if (el1 >= 0) {
+                if (!pass.rise_ok) {
+                    pass.rise_time = pc.t0;
+                    pass.rise_time += s/SPD;
+                    pass.rise_az = az;
+                    pass.rise_ok = true;
                 }
+            } else if (!pass.set_ok) {
+                pass.set_time = pc.t0;
+                pass.set_time += s/SPD;
+                pass.set_az = az;
+                pass.set_ok = true;
             }
-	}
+        }
 
-	// Serial.printf ("R %d S %d dt %ld from_now %8.3fs tel %g\n", rise_ok, set_ok, dt, 24*3600*(t_srch - t_now), tel);
+        s0 = s1;
+        el0 = el1;
+    }
 
-	// advance time and save tel
-	t_srch += dt;
-	pel = tel;
+    // find max el of the pass in progress or else the next pass
+    if (pass.rise_ok && pass.set_ok) {
+        float s_rise = SPD*(pass.rise_time - pc.t0);
+        float s_set = SPD*(pass.set_time - pc.t0);
+        if (s_set < s_rise)
+            findMaxEl (pc, 0, s_set, pass);
+        else
+            findMaxEl (pc, s_rise, s_set, pass);
     }
 
+    return (pc.n);
+}
+
+/* find next rise and set times if sat valid.
+ * always find rise and set in the future, so set_time will be < rise_time iff pass is in progress.
+ * also update flags ever_up, set_ok, ever_down and rise_ok, and max_time, max_el, max_az and
+ * max_ok for the pass in progress or else the next pass.
+ */
+static void findNextPass(char *name)
+{
+    if (!sat || !obs) {
+	set_ok = rise_ok = max_ok = false;
+	return;
+    }
+
+    // measure how long this takes
+    uint32_t t0 = millis();
+
+    // search up to a few days ahead for next rise and set times (for example for moon)
+    resetWatchdog();
+    DateTime t_now = userNow();		// user's display time
+    SatPass pass;
+    int n_pred = findSatPass (sat, obs, t_now, PASS_SEARCH, pass);
+    rise_time = pass.rise_time;
+    set_time = pass.set_time;
+    max_time = pass.max_time;
+    rise_az = pass.rise_az;
+    set_az = pass.set_az;
+    max_el = pass.max_el;
+    max_az = pass.max_az;
+    rise_ok = pass.rise_ok;
+    set_ok = pass.set_ok;
+    max_ok = pass.max_ok;
+    ever_up = pass.ever_up;
+    ever_down = pass.ever_down;
+
     // new pass ready
     new_pass = true;
 
-    Serial.printf ("%s: next rise in %g hrs, set in %g (%ld ms)\n", name,
+    Serial.printf ("%s: next rise in %g hrs, set in %g (%d steps, %ld ms)\n", name,
 	rise_ok ? 24*(rise_time - t_now) : 0.0F, set_ok ? 24*(set_time - t_now) : 0.0F,
-        millis() - t0);
+        n_pred, millis() - t0);
 
     printFreeHeap (F("findNextPass"));
 }
@@ -353,17 +609,25 @@ static void drawNextPass()
     tft.setCursor (xc + r0 - 12, yc + r0 - 8);
     tft.print (F("SE"));
 
-    // connect several points from t until set_time, find max elevation for labeling
-    float max_el = 0;
-    uint16_t max_el_x = 0, max_el_y = 0;
+    // find topocentric positions of all steps at once
+    DateTime pt[MAX_PASS_STEPS];
+    float px[MAX_PASS_STEPS], py[MAX_PASS_STEPS], pz[MAX_PASS_STEPS];
+    float pel[MAX_PASS_STEPS], paz[MAX_PASS_STEPS];
+    SatStates ss = {{px, py, pz}, {NULL, NULL, NULL}};
+    for (uint8_t i = 0; i < n_steps; i++) {
+        pt[i] = t;
+        t += step_dt;
+    }
+    sat->predictMany (pt, n_steps, ss);
+    Satellite::topoMany (obs, ss, n_steps, pel, paz, NULL, NULL);
+
+    // connect several points from t until set_time
     uint16_t prev_x = 0, prev_y = 0;
     for (uint8_t i = 0; i < n_steps; i++) {
         resetWatchdog();
 
-        // find topocentric position @ t
-        float el, az, range, rate;
-        sat->predict (t);
-        sat->topo (obs, el, az, range, rate);
+        // topocentric position of step i
+        float el = pel[i], az = paz[i];
         if (el < 0 && n_steps == 1)
             break;                                      // only showing pos now but it's down
 
@@ -372,13 +636,6 @@ static void drawNextPass()
         uint16_t x = xc + r*sinf(deg2rad(az)) + 0.5F;	// want east right
         uint16_t y = yc - r*cosf(deg2rad(az)) + 0.5F;	// want north up
 
-        // find max el
-        if (el > max_el) {
-            max_el = el;
-            max_el_x = x;
-            max_el_y = y;
-        }
-
         // connect if have prev or just dot if only one
         if (i > 0 && (prev_x != x || prev_y != y))      // avoid bug with 0-length line
             tft.drawLine (prev_x, prev_y, x, y, PASS_COLOR);
@@ -397,15 +654,15 @@ static void drawNextPass()
         // save
         prev_x = x;
         prev_y = y;
-
-        // next t
-        t += step_dt;
     }
 
     // label max elevation and time up iff we have a full pass
-    if (max_el > 0 && full_pass) {
+    if (max_ok && max_el > 0 && full_pass) {
 
-        // max el
+        // max el, as found by findNextPass()
+        float r = r0*(90-max_el)/90;
+        uint16_t max_el_x = xc + r*sinf(deg2rad(max_az)) + 0.5F;
+        uint16_t max_el_y = yc - r*cosf(deg2rad(max_az)) + 0.5F;
         uint16_t x = max_el_x, y = max_el_y;
         bool draw_left_of_pass = max_el_x > xc;
         bool draw_below_pass = max_el_y < yc;
@@ -498,7 +755,7 @@ static void setSatMapNameLoc()
     } else {
 	// locate name far from current location and potential obstacles.
 	// N.B. start choice above RSS and below sun and moon
-	SCoord loc = sat_path[0];
+	SCoord loc = sat_path[path_head];
 	if (loc.x < map_b.x + map_b.w/2) {
 	    // Indian ocean
 	    map_name_b.x = map_b.x + 5*map_b.w/8;
@@ -509,9 +766,9 @@ static void setSatMapNameLoc()
 	    map_name_b.y = rss_bnr_b.y - map_name_b.h - 5;
 	}
 
-	// check it's not on the path 
-	for (uint16_t p = 0; p < n_path; p++) {
-	    SCoord s = sat_path[p];
+	// check it's not on the path
+	for (uint16_t p = 0; p < n_pts; p++) {
+	    SCoord s = sat_pts[p];
 	    if (inBox (s, map_name_b))
 		map_name_b.x = s.x + 20;
 	}
@@ -616,7 +873,7 @@ static void drawSatTime (const char *title, float t)
 /* return whether the given line appears to be a valid TLE
  * only count digits and '-' counts as 1
  */
-static bool tleHasValidChecksum (const char *line)
+bool tleHasValidChecksum (const char *line)
 {
     // sum first 68 chars
     int sum = 0;
@@ -672,10 +929,22 @@ static void showSelectionBox (uint16_t x, uint16_t y, bool on)
 }
 
 
+/* define sat from the given name and TLE fetched at the given time
+ */
+static void defineSat (const char *name, const char *t1, const char *t2, time_t fetched)
+{
+    memcpy (sat_name, name, sizeof(sat_name)-1);        // update so cases match, retain EOS
+    sat = new Satellite (t1, t2);
+    tle_refresh = fetched;
+    resetSatPath();
+}
+
 /* look up sat_name. if found set up sat, else inform user and remove sat altogether.
- * return whether found it.
+ * use the stored TLE if fetched within TLE_REFRESH, or if any_age and its epoch is still usable,
+ * or if the network fails. otherwise ask the backend for it only if it has changed.
+ * return whether found.
  */
-static bool satLookup ()
+static bool satLookup (bool any_age)
 {
     Serial.printf ("Looking up %s\n", sat_name);
 
@@ -691,20 +960,43 @@ static bool satLookup ()
     WiFiClient tle_client;
     char t1[TLE_LINEL], t2[TLE_LINEL];
     char name[100];
+    char c_name[NV_SATNAME_LEN];
+    time_t c_fetched, c_epoch;
+    int status = 0;
     bool ok = false;
 
+    // use stored TLE if fresh enough.
+    // N.B. fetch times are real UTC but usability depends on the displayed time, which includes the user offset
+    time_t utc = now();
+    bool cached = getCachedTLE (sat_name, c_name, t1, t2, &c_fetched, &c_epoch);
+    float max_age = strcmp_P (sat_name, PSTR("Moon")) ? MAX_TLE_AGE : 1.5F;
+    bool usable = cached && labs (nowWO() - c_epoch) < max_age*SPD;
+    if (cached && (utc - c_fetched < TLE_REFRESH || (any_age && usable))) {
+        Serial.printf ("Using stored TLE for %s\n", c_name);
+        defineSat (c_name, t1, t2, c_fetched);
+        return (true);
+    }
+
     resetWatchdog();
     if (wifiOk() && tle_client.connect (svr_host, HTTPPORT)) {
 	resetWatchdog();
 
-	// query
+	// query, unless not changed since stored
 	snprintf (name, sizeof(name), sat_one_page, sat_name);
-	httpGET (tle_client, svr_host, name);
-	if (!httpSkipHeader (tle_client)) {
+	httpGETIMS (tle_client, svr_host, name, cached ? c_fetched : 0);
+	if (!httpSkipHeader (tle_client, &status)) {
 	    fatalSatError ("Bad http header");
 	    goto out;
 	}
 
+        // stored TLE is still current
+        if (status == 304 && cached) {
+            putCachedTLE (c_name, NULL, NULL);
+	    defineSat (c_name, t1, t2, utc);
+            ok = true;
+            goto out;
+        }
+
 	// first response line is sat name, should match query
 	if (!getTCPLine (tle_client, name, sizeof(name), NULL)) {
 	    fatalSatError ("Satellite %s not found", sat_name);
@@ -733,10 +1025,16 @@ static bool satLookup ()
 	    goto out;
 	}
 
-	// TLE looks good, update name so cases match, define new sat
-        memcpy (sat_name, name, sizeof(sat_name)-1);    // retain EOS
-	sat = new Satellite (t1, t2);
-	tle_refresh = nowWO();
+	// TLE looks good, store and define new sat
+        putCachedTLE (name, t1, t2);
+	defineSat (name, t1, t2, utc);
+	ok = true;
+
+    } else if (usable) {
+
+        // carry on with stored TLE, try again after TLE_REFRESH
+        Serial.printf ("Network error, using stored TLE for %s\n", c_name);
+	defineSat (c_name, t1, t2, utc);
 	ok = true;
 
     } else {
@@ -809,17 +1107,20 @@ static bool askSat (bool timeout)
     int8_t sel_idx = NO_SAT;
     uint8_t n_sat = 0;
 
-    // open connection
+    // use stored list if any, else open connection
     WiFiClient sat_client;
+    bool stored = freshenTLECache();
     resetWatchdog();
-    if (!wifiOk() || !sat_client.connect (svr_host, HTTPPORT))
+    if (!stored && (!wifiOk() || !sat_client.connect (svr_host, HTTPPORT)))
         goto out;
 
     // query page and skip header
     resetWatchdog();
-    httpGET (sat_client, svr_host, sat_get_all);
-    if (!httpSkipHeader (sat_client))
-        goto out;
+    if (!stored) {
+        httpGET (sat_client, svr_host, sat_get_all);
+        if (!httpSkipHeader (sat_client))
+            goto out;
+    }
 
     // read and display each sat
     selectFontStyle (LIGHT_FONT, SMALL_FONT);
@@ -827,7 +1128,10 @@ static bool askSat (bool timeout)
 
         // read name and 2 lines, done when eof
         char t1[TLE_LINEL], t2[TLE_LINEL];
-        if (!getTCPLine (sat_client, &sat_names[n_sat][0], NV_SATNAME_LEN, NULL)
+        if (stored) {
+            if (!getCachedTLEn (n_sat, &sat_names[n_sat][0], t1, t2))
+                break;
+        } else if (!getTCPLine (sat_client, &sat_names[n_sat][0], NV_SATNAME_LEN, NULL)
                          || !getTCPLine (sat_client, t1, sizeof(t1), NULL)
                          || !getTCPLine (sat_client, t2, sizeof(t2), NULL)) {
             break;
@@ -1055,6 +1359,22 @@ float *rdtp, float *sdtp)
 }
 
 
+/* return max elevation and its az, degrees, and hours from now, of the pass in progress or else
+ * the next pass, if known.
+ */
+bool getSatMaxEl (float *elp, float *azp, float *mdtp)
+{
+    if (!obs || !sat || !SAT_NAME_IS_SET() || !max_ok)
+	return (false);
+
+    *elp = max_el;
+    *azp = max_az;
+    *mdtp = (max_time - userNow())*24;
+
+    return (true);
+}
+
+
 /* called by main loop() to update pass info.
  * once per second is enough, not needed at all if no sat named or !dx_info_for_sat
  * the _path_ is updated much less often in updateSatPath().
@@ -1077,7 +1397,7 @@ void updateSatPass()
 	    last_run += 60000UL;
 	    return;
 	}
-	if (!satLookup()) {
+	if (!satLookup(true)) {
 	    return;
 	}
 	if (!checkSatEpoch()) {
@@ -1134,6 +1454,8 @@ void updateSatPass()
 
 /* compute satellite geocentric path into sat_path[] and footprint into sat_foot[].
  * called once at the top of each map sweep so we can afford more extenstive checks than updateSatPass().
+ * the path is kept as a ring on a fixed time grid so each call only drops the samples now past and adds as
+ * many new ones at the end, unless the projection or the time changed too much.
  * just skip if no named satellite or time is not confirmed.
  * the _pass_ is updated in updateSatPass().
  * we also update map_name_b to avoid the current sat location.
@@ -1147,7 +1469,7 @@ void updateSatPath()
 
     // look up if first time
     if (!sat) {
-	if (!satLookup())
+	if (!satLookup(true))
 	    return;
 	// init pass info for updateSatPass()
 	findNextPass(sat_name);
@@ -1157,7 +1479,7 @@ void updateSatPath()
     if (!checkSatEpoch()) {
 	// not valid, maybe a fresh element set will be ok
         Serial.printf ("%s out of date\n", sat_name);
-	if (!satLookup())
+	if (!satLookup(false))
 	    return;
 	if (!checkSatEpoch()) {
 	    // no update or still bad epoch, give up on this sat
@@ -1170,12 +1492,6 @@ void updateSatPath()
 
     // from here we have a valid sat to report
 
-    // free sat_path first since it was last to be malloced
-    if (sat_path) {
-	free (sat_path);
-	sat_path = NULL;
-    }
-
     // fill sat_foot
     DateTime t = userNow();
     float satlat, satlng;
@@ -1183,33 +1499,72 @@ void updateSatPath()
     sat->geo (satlat, satlng);
     updateFootPrint(satlat, satlng);
 
-    // start sat_path max size, then reduce when know size needed
-    sat_path = (SCoord *) malloc (MAX_PATH * sizeof(SCoord));
+    // sat_path ring is max size, allocated once
     if (!sat_path) {
-	Serial.println (F("Failed to malloc sat_path"));
-	while (1);	// timeout
+        sat_path = (SCoord *) malloc (MAX_PATH * sizeof(SCoord));
+        if (!sat_path) {
+            Serial.println (F("Failed to malloc sat_path"));
+            while (1);	// timeout
+        }
+        resetSatPath();
     }
 
-    // fill sat_path
-    float period = sat->period();
-    n_path = 0;
-    uint16_t max_path = isSatMoon() ? 1 : MAX_PATH;         // N.B. only set the current location if Moon
-    for (uint16_t p = 0; p < max_path; p++) {
-	ll2s (satlat, satlng, sat_path[n_path], 2);
-	if (n_path == 0 || memcmp (&sat_path[n_path], &sat_path[n_path-1], sizeof(SCoord)))
-	    n_path++;
-	t += period/max_path;	// show 1 rev
-	sat->predict (t);
-	sat->geo (satlat, satlng);
+    if (isSatMoon()) {
+
+        // N.B. only set the current location if Moon
+        path_head = 0;
+        n_path = 1;
+
+    } else {
+
+        // start over if the projection changed
+        if (path_azm != azm_on || memcmp (&path_map_b, &map_b, sizeof(SBox))
+                        || (azm_on && (path_de.lat != de_ll.lat || path_de.lng != de_ll.lng))) {
+            path_azm = azm_on;
+            path_de = de_ll;
+            path_map_b = map_b;
+            resetSatPath();
+        }
+
+        // drop samples now in the past, or start over if time moved outside the path
+        float step = sat->period()/MAX_PATH;    // show 1 rev
+        long k_now = n_path > 0 ? (long) floorf ((t - path_t0)/step) : 0;
+        if (n_path == 0 || k_now < path_k0 || k_now >= path_k0 + n_path) {
+            path_t0 = t;
+            path_k0 = 0;
+            path_head = 0;
+            n_path = 0;
+        } else {
+            uint16_t n_drop = k_now - path_k0;
+            path_head = (path_head + n_drop) % MAX_PATH;
+            n_path -= n_drop;
+            path_k0 = k_now;
+        }
+
+        // propagate just the new tail, PATH_BATCH steps at a time to keep the arrays on the stack
+        while (n_path < MAX_PATH) {
+            DateTime bt[PATH_BATCH];
+            float bx[PATH_BATCH], by[PATH_BATCH], bz[PATH_BATCH];
+            float blat[PATH_BATCH], blng[PATH_BATCH];
+            SatStates ss = {{bx, by, bz}, {NULL, NULL, NULL}};
+            int nb = MAX_PATH - n_path < PATH_BATCH ? MAX_PATH - n_path : PATH_BATCH;
+            for (int i = 0; i < nb; i++) {
+                bt[i] = path_t0;
+                bt[i] += (path_k0 + n_path + i)*step;
+            }
+            sat->predictMany (bt, nb, ss);
+            Satellite::geoMany (ss, nb, blat, blng);
+            for (int i = 0; i < nb; i++)
+                ll2s (blat[i], blng[i], sat_path[(path_head + n_path++) % MAX_PATH], 2);
+        }
     }
+
+    // first is always exactly now
+    ll2s (satlat, satlng, sat_path[path_head], 2);
     // Serial.printf ("n_path %u / %u\n", n_path, MAX_PATH);
 
-    // reduce
-    sat_path = (SCoord *) realloc (sat_path, n_path * sizeof(SCoord));
-    if (!sat_path) {
-	Serial.println (F("Failed to realloc sat_path"));
-	while (1);	// timeout
-    }
+    // the ring changed so rebuild the points to draw
+    updateSatPoints();
 
     // set map name to avoid current location
     setSatMapNameLoc();
@@ -1226,8 +1581,11 @@ void drawSatPointsOnRow (uint16_t y0)
 
     // draw fat pixel on row above to avoid next row erasing it
 
-    for (uint16_t p = 0; p < n_path; p++) {
-        SCoord s = sat_path[p];
+    tft.beginBatch();
+    tft.beginOverlay();
+
+    for (uint16_t p = 0; p < n_pts; p++) {
+        SCoord s = sat_pts[p];
         if (y0 == s.y && overMap(s)) {
             tft.drawPixel (s.x, s.y, TRACK_COLOR);
             s.y -= 1;
@@ -1251,6 +1609,9 @@ void drawSatPointsOnRow (uint16_t y0)
 	    if (overMap(s)) tft.drawPixel (s.x, s.y, FP_COLOR);
 	}
     }
+
+    tft.endOverlay();
+    tft.endBatch();
 }
 
 /* draw sat name on map if it includes row y0 unless already showing in dx_info.
@@ -1273,7 +1634,9 @@ void drawSatNameOnRow(uint16_t y0)
     selectFontStyle (LIGHT_FONT, SMALL_FONT);
     tft.setTextColor (SAT_COLOR);
     tft.setCursor (map_name_b.x, map_name_b.y + map_name_b.h - 1);
+    tft.beginOverlay();
     tft.print (user_name);
+    tft.endOverlay();
 }
 
 /* return whether user has tapped near the head of the satellite path or in the map name
@@ -1284,8 +1647,8 @@ bool checkSatTouch (const SCoord &s)
 	return (false);
 
     SBox sat_b;
-    sat_b.x = sat_path[0].x-SAT_TOUCH_R;
-    sat_b.y = sat_path[0].y-SAT_TOUCH_R;
+    sat_b.x = sat_path[path_head].x-SAT_TOUCH_R;
+    sat_b.y = sat_path[path_head].y-SAT_TOUCH_R;
     sat_b.w = 2*SAT_TOUCH_R;
     sat_b.h = 2*SAT_TOUCH_R;
 
@@ -1314,8 +1677,8 @@ void displaySatInfo()
     }
 
     // freshen elements if stale
-    if (nowWO() - tle_refresh > TLE_REFRESH) {
-	if (!satLookup())
+    if (now() - tle_refresh > TLE_REFRESH) {
+	if (!satLookup(false))
 	    return;
     }
 
@@ -1338,7 +1701,7 @@ bool querySatSelection(bool timeout)
     NVReadString (NV_SATNAME, sat_name);
     if (askSat(timeout)) {
         Serial.printf ("Selected sat '%s'\n", sat_name);
-	if (!satLookup())
+	if (!satLookup(false))
 	    return (false);
 	findNextPass(sat_name);
     } else {
@@ -1369,7 +1732,7 @@ bool setSatFromName (const char *new_name)
 
     strncpySubChar (sat_name, new_name, '_', ' ', NV_SATNAME_LEN);
 
-    if (satLookup()) {
+    if (satLookup(false)) {
 	// found
 
         // stop any tracking
@@ -1399,13 +1762,14 @@ bool setSatFromTLE (const char *name, const char *t1, const char *t2)
     stopGimbalNow();
 
     sat = new Satellite (t1, t2);
+    resetSatPath();
     if (!checkSatEpoch()) {
         delete sat;
 	sat = NULL;
         fatalSatError ("Elements out of date");
         return (false);
     }
-    tle_refresh = nowWO();
+    tle_refresh = now();
     dx_info_for_sat = true;
     strncpySubChar (sat_name, name, '_', ' ', NV_SATNAME_LEN);
     initScreen();
@@ -1429,6 +1793,13 @@ bool isNewPass()
     return (np);
 }
 
+/* return whether a satellite is defined, so its path may be on the map
+ */
+bool isSatDefined()
+{
+    return (sat != NULL);
+}
+
 /* return whether the current satellite is in fact the moon
  */
 bool isSatMoon()
@@ -0,0 +1,136 @@
+/* tool to write a big earth map file for mmapEarthMap() from the same table source once linked in.
+ *
+ * reads the preprocessed source of dearth-big.cpp or nearth-big.cpp on stdin, finds the initializer
+ * of the named table and writes its pixels as raw native-order RGB565 to <prefix>-<W>x<H>.bin.
+ * W and H are EARTH_BIG_W and EARTH_BIG_H so build with the same _CLOCK_ flag as the hamclock.
+ * see the earthmaps-* targets in the Makefile.
+ *
+ * usage: mkearthmap table prefix < source
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <stdint.h>
+#include <unistd.h>
+
+#include "Adafruit_RA8875.h"
+
+/* return a malloced copy of all of fp, or NULL
+ */
+static char *readAll (FILE *fp)
+{
+    size_t n = 0, size = 1 << 20;
+    char *buf = (char *) malloc (size);
+    size_t nr;
+
+    while (buf && (nr = fread (buf + n, 1, size - n - 1, fp)) > 0) {
+        n += nr;
+        if (n == size - 1)
+            buf = (char *) realloc (buf, size *= 2);
+    }
+    if (buf)
+        buf[n] = '\0';
+    return (buf);
+}
+
+/* return pointer to the opening brace of the initializer for the given table, else NULL.
+ * N.B. skips any mention of the name not followed by its dimensions then '='.
+ */
+static const char *findTable (const char *src, const char *table)
+{
+    size_t tl = strlen (table);
+
+    for (const char *s = strstr (src, table); s; s = strstr (s + tl, table)) {
+        if (s > src && (isalnum (s[-1]) || s[-1] == '_'))
+            continue;
+        const char *p = s + tl;
+        while (isspace (*p) || *p == '[' || *p == ']' || isalnum (*p) || *p == '_')
+            p++;
+        if (*p++ != '=')
+            continue;
+        while (isspace (*p))
+            p++;
+        if (*p == '{')
+            return (p);
+    }
+    return (NULL);
+}
+
+int main (int ac, char *av[])
+{
+    if (ac != 3) {
+        fprintf (stderr, "Usage: %s table prefix < source\n", av[0]);
+        return (1);
+    }
+    const char *table = av[1];
+    const char *prefix = av[2];
+    const long n_pix = (long)EARTH_BIG_W * EARTH_BIG_H;
+
+    char *src = readAll (stdin);
+    if (!src) {
+        fprintf (stderr, "%s: no memory\n", table);
+        return (1);
+    }
+
+    const char *p = findTable (src, table);
+    if (!p) {
+        fprintf (stderr, "%s: no initializer found\n", table);
+        return (1);
+    }
+
+    uint16_t *pix = (uint16_t *) malloc (n_pix * sizeof(uint16_t));
+    if (!pix) {
+        fprintf (stderr, "%s: no memory\n", table);
+        return (1);
+    }
+
+    // collect each number until the outer brace closes
+    long n = 0;
+    int depth = 0;
+    do {
+        if (*p == '{')
+            depth++;
+        else if (*p == '}')
+            depth--;
+        else if (isdigit (*p)) {
+            char *end;
+            unsigned long v = strtoul (p, &end, 0);
+            if (n < n_pix)
+                pix[n] = v;
+            n++;
+            p = end;
+            continue;
+        } else if (*p == '\0') {
+            fprintf (stderr, "%s: unterminated initializer\n", table);
+            return (1);
+        }
+        p++;
+    } while (depth > 0);
+
+    if (n != n_pix) {
+        fprintf (stderr, "%s: found %ld pixels but %dx%d needs %ld\n", table, n, EARTH_BIG_W, EARTH_BIG_H,
+                        n_pix);
+        return (1);
+    }
+
+    // write to temp then rename so a failure never leaves a file mmapEarthMap() would accept
+    char fn[1024], tmp[1100];
+    snprintf (fn, sizeof(fn), "%s-%dx%d.bin", prefix, EARTH_BIG_W, EARTH_BIG_H);
+    snprintf (tmp, sizeof(tmp), "%s.new", fn);
+    FILE *fp = fopen (tmp, "w");
+    if (!fp) {
+        perror (tmp);
+        return (1);
+    }
+    bool ok = fwrite (pix, sizeof(uint16_t), n_pix, fp) == (size_t)n_pix;
+    if (fclose (fp) != 0 || !ok || rename (tmp, fn) < 0) {
+        perror (fn);
+        (void) unlink (tmp);
+        return (1);
+    }
+
+    printf ("%s\n", fn);
+    return (0);
+}
@@ -69,6 +69,7 @@ static NCDXFBeacon blist[NBEACONS] = {
 #define	BCOL_S	RA8875_BLACK	        // silent, not actually drawn
 #define	BCOL_N	6			// number of color states
 
+static bool beacons_moved;              // set when any beacon color, location or call box changes
 
 
 /* using the current user time set the color state for each beacon.
@@ -80,14 +81,21 @@ static void setBeaconStates ()
     int sc = second(t);
     uint16_t s_10 = (60*mn + sc)/10;
 
-    for (BeaconID id = 0; id < NBEACONS; id++)
+    uint16_t prev_c[NBEACONS];
+    for (BeaconID id = 0; id < NBEACONS; id++) {
+        prev_c[id] = blist[id].c;
 	blist[id].c = BCOL_S;
+    }
 
     blist[(s_10-0+NBEACONS)%NBEACONS].c = BCOL_14;
     blist[(s_10-1+NBEACONS)%NBEACONS].c = BCOL_18;
     blist[(s_10-2+NBEACONS)%NBEACONS].c = BCOL_21;
     blist[(s_10-3+NBEACONS)%NBEACONS].c = BCOL_24;
     blist[(s_10-4+NBEACONS)%NBEACONS].c = BCOL_28;
+
+    for (BeaconID id = 0; id < NBEACONS; id++)
+        if (blist[id].c != prev_c[id])
+            beacons_moved = true;
 }
 
 
@@ -104,10 +112,17 @@ static void drawBeaconSymbol (const SCoord &s, uint16_t c)
  */
 static void drawBeacon (NCDXFBeacon &nb)
 {
+    tft.beginOverlay();
+
     // triangle symbol
     drawBeaconSymbol (nb.s, nb.c);
 
+    SBox prev_b = nb.call_b;
     drawMapTag (nb.call, nb.s.x, nb.s.y, BEACONCH, nb.call_b);
+    if (memcmp (&prev_b, &nb.call_b, sizeof(prev_b)))
+        beacons_moved = true;
+
+    tft.endOverlay();
 }
 
 /* erase beacon
@@ -117,18 +132,15 @@ static void eraseBeacon (NCDXFBeacon &nb)
 {
     resetWatchdog();
 
-    // redraw map
+    // restore map
     for (int8_t dy = -BEACONR; dy <= BEACONR/2; dy += 1) {
 	int8_t hw = 3*(dy+BEACONR)/5+1;
-	for (int8_t dx = -hw; dx <= hw; dx += 1)
-	    drawMapCoord (nb.s.x+dx, nb.s.y+dy);
+	eraseMapSpan (nb.s.x-hw, nb.s.y+dy, 2*hw+1);
     }
 
-    // redraw map
-    for (uint16_t y = nb.call_b.y; y < nb.call_b.y + nb.call_b.h; y++) {
-        for (uint16_t x = nb.call_b.x; x < nb.call_b.x + nb.call_b.w; x++)
-	    drawMapCoord (x, y);
-    }
+    // restore map
+    for (uint16_t y = nb.call_b.y; y < nb.call_b.y + nb.call_b.h; y++)
+        eraseMapSpan (nb.call_b.x, y, nb.call_b.w);
 }
 
 
@@ -208,6 +220,7 @@ void updateBeaconScreenLocations()
 {
     for (NCDXFBeacon *bp = blist; bp < &blist[NBEACONS]; bp++)
 	ll2s (deg2rad(bp->lat), deg2rad(bp->lng), bp->s, 3*BEACONCW);   // about max
+    beacons_moved = true;
 }
 
 /* return whether the given screen coord is over any visible symbol or call box
@@ -227,6 +240,41 @@ bool overAnyBeacon (const SCoord &s)
     return (false);
 }
 
+/* return whether any beacon changed color, location or call box since last call, and always reset.
+ */
+bool beaconsMoved()
+{
+    bool moved = beacons_moved;
+    beacons_moved = false;
+    return (moved);
+}
+
+#if !defined(_USE_DESKTOP)
+
+/* add the bounding box of each visible beacon symbol and call box to the map occupancy mask.
+ */
+void occupyBeacons()
+{
+    if (brb_mode != BRB_SHOW_BEACONS)
+        return;
+
+    for (NCDXFBeacon *bp = blist; bp < &blist[NBEACONS]; bp++) {
+        if (bp->c == BCOL_S)
+            continue;
+
+        // same extent as overBeacon()
+        SBox b;
+        b.x = bp->s.x - BEACONR;
+        b.y = bp->s.y - BEACONR;
+        b.w = 2*BEACONR + 1;
+        b.h = BEACONR + BEACONR/2 + 1;
+        occupyMapBox (b);
+        occupyMapBox (bp->call_b);
+    }
+}
+
+#endif // !_USE_DESKTOP
+
 /* draw the beacon control box
  */
 void drawBeaconBox()
@@ -115,14 +115,7 @@ void drawSanta()
             // Serial.printf ("Erasing santa from %d x %d\n", santa_b.x, santa_b.y);
             for (uint8_t sr = 0; sr < SANTA_H; sr++) {
                 resetWatchdog();
-                for (uint8_t sc = 0; sc < SANTA_W; sc++) {
-                    for (uint8_t bc = 0; bc < 8; bc++) {
-                        uint16_t sx = santa_b.x + 8*sc + bc;
-                        uint16_t sy = santa_b.y + sr;
-                        SCoord ss = {sx, sy};
-                        drawMapCoord(ss);
-                    }
-                }
+                eraseMapSpan (santa_b.x, santa_b.y + sr, SANTA_WPIX);
             }
         }
 
@@ -138,6 +131,7 @@ void drawSanta()
 
         // paint
         // Serial.printf ("Painting santa at %d x %d\n", santa_b.x, santa_b.y);
+        tft.beginOverlay();
         for (uint8_t sr = 0; sr < SANTA_H; sr++) {
             resetWatchdog();
             for (uint8_t sc = 0; sc < SANTA_W; sc++) {
@@ -147,15 +141,12 @@ void drawSanta()
                     uint16_t sy = santa_b.y + sr;
                     if (mask & (1<<bc))
                         tft.drawPixel (sx, sy, SANTA_C);
-                    else {
-                        SCoord s;
-                        s.x = sx;
-                        s.y = sy;
-                        drawMapCoord(s);
-                    }
+                    else
+                        eraseMapSpan (sx, sy, 1);
                 }
             }
         }
+        tft.endOverlay();
 
         resetWatchdog();
         printFreeHeap (F("Santa"));
@@ -0,0 +1,327 @@
+/* catalog of all the satellites offered by the backend, each with a rolling table of its passes over
+ * DE, and all of them merged into one timeline of upcoming passes sorted by rise time.
+ *
+ * TLEs come from the TLE store, which is freshened on the main thread like all other network traffic,
+ * and the catalog is rebuilt each time the store is. passes are found by a pool of
+ * worker threads that each claim the next sat needing work. the tables are only merged into the
+ * timeline on the main thread after all workers have finished so readers never wait or lock.
+ * each table spans SATCAT_SPAN and is found again once it is SATCAT_STALE old, so there is always
+ * at least SATCAT_SPAN - SATCAT_STALE of passes ahead.
+ *
+ * desktop only; elsewhere the catalog is always empty.
+ */
+
+#include "HamClock.h"
+
+#if defined(_USE_DESKTOP)
+
+#define SATCAT_MAX      250                     // max sats in catalog
+#define SATCAT_NPASS    24                      // max passes kept for each sat
+#define SATCAT_SPAN     (48*3600L)              // each pass table spans this long, seconds
+#define SATCAT_STALE    (24*3600L)              // find passes again when a table is this old, seconds
+#if !defined(SATCAT_THREADS)
+#define SATCAT_THREADS  0                       // n pass workers, 0 for one per online core
+#endif
+
+// one catalog satellite
+typedef struct {
+    char name[NV_SATNAME_LEN];                  // name as in NV_SATNAME
+    Satellite sat;                              // elements, changed by each prediction
+    time_t t0;                                  // start of pass[], 0 if passes must be found
+    int n_pass;                                 // n in pass[]
+    SatCatPass pass[SATCAT_NPASS];              // passes from t0 to t0 + SATCAT_SPAN, by rise time
+} CatSat;
+
+static CatSat *cat;                             // new[]ed catalog
+static int n_cat;                               // n in cat[]
+static time_t cat_tle_t;                        // cachedTLEsFetched() when cat[] was built, 0 never
+static Observer *cat_obs;                       // DE for all passes
+static LatLong cat_de;                          // de_ll when cat_obs was made
+static SatCatPass *cat_tl;                      // malloced timeline of all passes by rise time
+static int n_cat_tl;                            // n in cat_tl[]
+
+// pass workers, they only run while updateSatCat() is not changing anything they use
+static pthread_t *catw_tids;                    // malloced ids of running workers
+static int catw_n;                              // n workers running, 0 if none
+static volatile int catw_next;                  // cat[] index for next sat to claim, use atomically
+static volatile int catw_done;                  // n workers finished, use atomically
+static time_t catw_t0;                          // nowWO() when workers were started
+static DateTime catw_dt0;                       // catw_t0 as a DateTime
+
+
+/* return a DateTime for the given unix time
+ */
+static DateTime unix2DT (time_t t)
+{
+    DateTime dt(year(t), month(t), day(t), hour(t), minute(t), second(t));
+    return (dt);
+}
+
+/* return number of workers to use
+ */
+static int nSatCatWorkers()
+{
+    static int n;
+    if (n == 0) {
+        n = SATCAT_THREADS > 0 ? SATCAT_THREADS : sysconf (_SC_NPROCESSORS_ONLN);
+        if (n < 1)
+            n = 1;
+    }
+    return (n);
+}
+
+/* add one pass to cs.pass[] at the given seconds after catw_t0, return whether there is room for more.
+ */
+static bool addCatPass (CatSat &cs, float s_rise, float rise_az, float s_set, float set_az, float max_el)
+{
+    SatCatPass &p = cs.pass[cs.n_pass++];
+    memcpy (p.name, cs.name, sizeof(p.name));
+    p.rise = catw_t0 + (time_t)s_rise;
+    p.set = catw_t0 + (time_t)s_set;
+    p.rise_az = rise_az;
+    p.set_az = set_az;
+    p.max_el = max_el;
+    return (cs.n_pass < SATCAT_NPASS);
+}
+
+/* find all passes of cs from catw_t0 for SATCAT_SPAN.
+ * N.B. called by workers, only changes cs.
+ */
+static void findCatPasses (CatSat &cs)
+{
+    cs.n_pass = 0;
+
+    float s = 0;                                // search start, seconds after catw_t0
+    while (s < SATCAT_SPAN) {
+
+        DateTime t = catw_dt0;
+        t += s/SPD;
+        SatPass p;
+        (void) findSatPass (&cs.sat, cat_obs, t, SATCAT_SPAN - s, p);
+        float max_el = p.max_ok ? p.max_el : 0;
+        float s_rise = s + SPD*(p.rise_time - t);
+        float s_set = s + SPD*(p.set_time - t);
+
+        if (p.set_ok && p.rise_ok && s_rise < s_set) {
+            // pass lies ahead
+            if (!addCatPass (cs, s_rise, p.rise_az, s_set, p.set_az, max_el))
+                break;
+        } else if (p.set_ok) {
+            // pass in progress
+            if (!addCatPass (cs, s, SAT_NOAZ, s_set, p.set_az, max_el))
+                break;
+        } else if (p.rise_ok) {
+            // rises but does not set in time
+            (void) addCatPass (cs, s_rise, p.rise_az, SATCAT_SPAN, SAT_NOAZ, max_el);
+            break;
+        } else {
+            // up all the time or never
+            if (!p.ever_down)
+                (void) addCatPass (cs, s, SAT_NOAZ, SATCAT_SPAN, SAT_NOAZ, max_el);
+            break;
+        }
+
+        // resume after this set
+        s = s_set;
+    }
+
+    cs.t0 = catw_t0;
+}
+
+/* thread to find passes for each stale catalog sat until there are no more.
+ */
+static void *catWorker (void *unused)
+{
+    (void) unused;
+
+    int i;
+    while ((i = __sync_fetch_and_add (&catw_next, 1)) < n_cat) {
+        CatSat &cs = cat[i];
+        if (cs.t0 == 0 || catw_t0 - cs.t0 >= SATCAT_STALE)
+            findCatPasses (cs);
+    }
+
+    __sync_add_and_fetch (&catw_done, 1);
+    return (NULL);
+}
+
+/* start workers for all stale sats, return whether any are running.
+ * if not, catWorker() may be called directly.
+ */
+static bool startSatCatWorkers (time_t now)
+{
+    catw_t0 = now;
+    catw_dt0 = unix2DT (now);
+    catw_next = 0;
+    catw_done = 0;
+
+    int n = nSatCatWorkers();
+    if (!catw_tids) {
+        catw_tids = (pthread_t *) malloc (n * sizeof(pthread_t));
+        if (!catw_tids)
+            return (false);
+    }
+
+    for (catw_n = 0; catw_n < n; catw_n++) {
+        int e = pthread_create (&catw_tids[catw_n], NULL, catWorker, NULL);
+        if (e) {
+            Serial.printf ("catWorker: %s\n", strerror(e));
+            break;
+        }
+    }
+
+    return (catw_n > 0);
+}
+
+/* qsort compare SatCatPass by rise time
+ */
+static int qsCatPass (const void *p1, const void *p2)
+{
+    time_t r1 = ((SatCatPass *)p1)->rise;
+    time_t r2 = ((SatCatPass *)p2)->rise;
+    return (r1 < r2 ? -1 : (r1 > r2 ? 1 : 0));
+}
+
+/* merge the passes of all sats into the timeline.
+ */
+static void mergeSatCat()
+{
+    int n = 0;
+    for (int i = 0; i < n_cat; i++)
+        n += cat[i].n_pass;
+
+    SatCatPass *tl = (SatCatPass *) realloc (cat_tl, (n > 0 ? n : 1) * sizeof(SatCatPass));
+    if (!tl) {
+        Serial.printf ("SatCat: no memory for %d passes\n", n);
+        return;
+    }
+    cat_tl = tl;
+
+    n_cat_tl = 0;
+    for (int i = 0; i < n_cat; i++) {
+        memcpy (&cat_tl[n_cat_tl], cat[i].pass, cat[i].n_pass * sizeof(SatCatPass));
+        n_cat_tl += cat[i].n_pass;
+    }
+    qsort (cat_tl, n_cat_tl, sizeof(SatCatPass), qsCatPass);
+}
+
+/* build a fresh catalog from all stored TLEs, return whether any.
+ * N.B. workers must not be running
+ */
+static bool readSatCat()
+{
+    CatSat *new_cat = new CatSat[SATCAT_MAX];
+    int n_new = 0;
+
+    char t1[TLE_LINEL], t2[TLE_LINEL];
+    while (n_new < SATCAT_MAX && getCachedTLEn (n_new, new_cat[n_new].name, t1, t2)) {
+        CatSat &cs = new_cat[n_new++];
+        cs.sat.tle (t1, t2);
+        cs.t0 = 0;
+        cs.n_pass = 0;
+    }
+
+    if (n_new > 0) {
+        delete [] cat;
+        cat = new_cat;
+        n_cat = n_new;
+        Serial.printf ("SatCat: %d satellites\n", n_cat);
+    } else
+        delete [] new_cat;
+
+    return (n_new > 0);
+}
+
+/* called often by main loop() to keep the catalog fresh.
+ * collects finished workers, else reads TLEs or starts workers if time.
+ * N.B. only freshening the TLE store takes any time, and only every TLE_REFRESH.
+ */
+void updateSatCat()
+{
+    // collect workers when all are finished
+    if (catw_n > 0) {
+        if (catw_done < catw_n)
+            return;
+        for (int i = 0; i < catw_n; i++)
+            pthread_join (catw_tids[i], NULL);
+        catw_n = 0;
+        mergeSatCat();
+    }
+
+    // once per second is plenty
+    static uint32_t last_run;
+    if (!timesUp (&last_run, 1000) || !clockTimeOk())
+        return;
+    time_t now = nowWO();
+
+    // fresh TLEs, all passes must be found again
+    if (freshenTLECache() && cachedTLEsFetched() != cat_tle_t) {
+        if (readSatCat())
+            cat_tle_t = cachedTLEsFetched();
+        for (int i = 0; i < n_cat; i++)
+            cat[i].t0 = 0;
+    }
+    if (n_cat == 0)
+        return;
+
+    // new DE, all passes must be found again
+    if (!cat_obs || cat_de.lat_d != de_ll.lat_d || cat_de.lng_d != de_ll.lng_d) {
+        delete cat_obs;
+        cat_obs = new Observer (de_ll.lat_d, de_ll.lng_d, 0);
+        cat_de = de_ll;
+        for (int i = 0; i < n_cat; i++)
+            cat[i].t0 = 0;
+    }
+
+    // start workers if any are stale
+    for (int i = 0; i < n_cat; i++) {
+        if (cat[i].t0 == 0 || now - cat[i].t0 >= SATCAT_STALE) {
+            if (!startSatCatWorkers (now)) {
+                // do them here if no threads
+                catWorker (NULL);
+                mergeSatCat();
+            }
+            break;
+        }
+    }
+}
+
+/* copy up to max of the next passes of all catalog sats, including any in progress, by rise time.
+ * return number copied.
+ */
+int getSatCatPasses (SatCatPass *pp, int max)
+{
+    time_t now = nowWO();
+    int n = 0;
+    for (int i = 0; i < n_cat_tl && n < max; i++)
+        if (cat_tl[i].set > now)
+            pp[n++] = cat_tl[i];
+    return (n);
+}
+
+/* return number of sats in the catalog
+ */
+int nSatCat()
+{
+    return (n_cat);
+}
+
+#else // !_USE_DESKTOP
+
+void updateSatCat()
+{
+}
+
+int getSatCatPasses (SatCatPass *pp, int max)
+{
+    (void) pp;
+    (void) max;
+    return (0);
+}
+
+int nSatCat()
+{
+    return (0);
+}
+
+#endif // _USE_DESKTOP
@@ -0,0 +1,377 @@
+/* persistent store of satellite TLEs so lookups need not wait for the network.
+ *
+ * the store is a text file in $HOME/.hamclock holding each TLE with its epoch and the time it was
+ * last fetched from or confirmed by the backend. it is read once into memory then rewritten whole
+ * after each change. the full list is freshened every TLE_REFRESH with a conditional request.
+ * fetch times are real UTC, without the user's time offset, since they are compared with the backend's.
+ *
+ * desktop only; elsewhere the store is always empty.
+ */
+
+#include "HamClock.h"
+
+#if defined(_USE_DESKTOP)
+
+#include <sys/stat.h>
+
+#define TLEC_FILE       "tles.txt"              // file name within $HOME/.hamclock
+#define TLEC_MAX        300                     // max TLEs in the store
+#define TLEC_RETRY      (10*60)                 // try the full list this often after an error, seconds
+
+// one stored TLE
+typedef struct {
+    char name[NV_SATNAME_LEN];                  // name as from the backend
+    time_t fetched;                             // when last fetched or confirmed
+    time_t epoch;                               // TLE epoch
+    char t1[TLE_LINEL], t2[TLE_LINEL];          // the elements
+} TLECache;
+
+static TLECache *tles;                          // malloced store
+static int n_tles;                              // n in tles[]
+static time_t all_fetched;                      // when full list was last fetched or confirmed, 0 never
+static time_t all_retry;                        // don't try full list again before this time
+static bool tles_loaded;                        // set once file has been read
+
+
+/* fill fn with the full path to the store, creating its directory if necessary.
+ * return whether HOME is known.
+ */
+static bool tleCacheFile (char *fn, size_t fn_len)
+{
+    const char *home = getenv ("HOME");
+    if (!home)
+        return (false);
+    snprintf (fn, fn_len, "%s/.hamclock", home);
+    (void) mkdir (fn, 0755);
+    snprintf (fn, fn_len, "%s/.hamclock/%s", home, TLEC_FILE);
+    return (true);
+}
+
+/* return the UNIX epoch of the given TLE line 1
+ */
+static time_t tleEpoch (const char *t1)
+{
+    // year is columns 19-20, day of year with fraction is columns 21-32
+    char yr[3] = {t1[18], t1[19], '\0'};
+    int y = atoi (yr);
+    float doy = atof (t1+20);
+
+    tmElements_t tm;
+    memset (&tm, 0, sizeof(tm));
+    tm.Year = CalendarYrToTm (y < 57 ? 2000 + y : 1900 + y);
+    tm.Month = 1;
+    tm.Day = 1;
+    return (makeTime (tm) + (time_t)((doy - 1) * SECS_PER_DAY));
+}
+
+/* rewrite the whole store.
+ * N.B. written to a temp file then renamed so a crash never leaves a partial file.
+ */
+static void saveTLECache()
+{
+    char fn[1024], tmp[1100];
+    if (!tleCacheFile (fn, sizeof(fn)))
+        return;
+    snprintf (tmp, sizeof(tmp), "%s.new", fn);
+
+    FILE *fp = fopen (tmp, "w");
+    if (!fp) {
+        printf ("%s: %s\n", tmp, strerror(errno));
+        return;
+    }
+
+    fprintf (fp, "all %ld\n", (long)all_fetched);
+    for (int i = 0; i < n_tles; i++) {
+        TLECache &tc = tles[i];
+        fprintf (fp, "%s %ld %ld\n%s\n%s\n", tc.name, (long)tc.fetched, (long)tc.epoch, tc.t1, tc.t2);
+    }
+
+    bool ok = fclose (fp) == 0;
+    if (!ok || rename (tmp, fn) < 0) {
+        printf ("%s: %s\n", fn, strerror(errno));
+        (void) unlink (tmp);
+    }
+}
+
+/* remove trailing white space from the given string in place
+ */
+static void chompTLE (char *s)
+{
+    size_t l = strlen (s);
+    while (l > 0 && isspace (s[l-1]))
+        s[--l] = '\0';
+}
+
+/* read the store into memory, if not already.
+ */
+static void loadTLECache()
+{
+    if (tles_loaded)
+        return;
+    tles_loaded = true;
+
+    tles = (TLECache *) malloc (TLEC_MAX * sizeof(TLECache));
+    if (!tles) {
+        printf ("TLECache: no memory\n");
+        return;
+    }
+
+    char fn[1024];
+    if (!tleCacheFile (fn, sizeof(fn)))
+        return;
+    FILE *fp = fopen (fn, "r");
+    if (!fp)
+        return;                                 // fine if first time
+
+    char line[128];
+    long t;
+    if (fgets (line, sizeof(line), fp) && sscanf (line, "all %ld", &t) == 1)
+        all_fetched = t;
+
+    while (n_tles < TLEC_MAX && fgets (line, sizeof(line), fp)) {
+        TLECache &tc = tles[n_tles];
+        char name[100], t1[128], t2[128];
+        long fetched, epoch;
+        if (sscanf (line, "%99s %ld %ld", name, &fetched, &epoch) != 3
+                            || !fgets (t1, sizeof(t1), fp) || !fgets (t2, sizeof(t2), fp))
+            break;
+        chompTLE (t1);
+        chompTLE (t2);
+        if (strlen (t1) >= sizeof(tc.t1) || strlen (t2) >= sizeof(tc.t2)
+                            || !tleHasValidChecksum (t1) || !tleHasValidChecksum (t2))
+            continue;
+        strncpy (tc.name, name, sizeof(tc.name)-1);
+        tc.name[sizeof(tc.name)-1] = '\0';
+        strcpy (tc.t1, t1);
+        strcpy (tc.t2, t2);
+        tc.fetched = fetched;
+        tc.epoch = epoch;
+        n_tles++;
+    }
+
+    fclose (fp);
+    printf ("TLECache: read %d from %s\n", n_tles, fn);
+}
+
+/* return index of the named TLE in tles[], ignoring case, else -1
+ */
+static int findTLECache (const char *name)
+{
+    for (int i = 0; i < n_tles; i++)
+        if (strcasecmp (tles[i].name, name) == 0)
+            return (i);
+    return (-1);
+}
+
+/* look up the named TLE, ignoring case.
+ * if found, copy the stored name and elements and return when they were fetched and their epoch.
+ * return whether found.
+ */
+bool getCachedTLE (const char *name, char stored_name[NV_SATNAME_LEN], char t1[TLE_LINEL], char t2[TLE_LINEL],
+    time_t *fetched, time_t *epoch)
+{
+    loadTLECache();
+
+    int i = findTLECache (name);
+    if (i < 0)
+        return (false);
+
+    TLECache &tc = tles[i];
+    memcpy (stored_name, tc.name, NV_SATNAME_LEN);
+    memcpy (t1, tc.t1, TLE_LINEL);
+    memcpy (t2, tc.t2, TLE_LINEL);
+    *fetched = tc.fetched;
+    *epoch = tc.epoch;
+    return (true);
+}
+
+/* add or replace the named TLE, fetched just now, and save.
+ * also just marks an existing TLE as fetched now if t1 and t2 are NULL.
+ */
+void putCachedTLE (const char *name, const char *t1, const char *t2)
+{
+    loadTLECache();
+    if (!tles)
+        return;
+
+    int i = findTLECache (name);
+    if (i < 0) {
+        if (!t1 || !t2 || n_tles == TLEC_MAX)
+            return;
+        i = n_tles++;
+    }
+
+    TLECache &tc = tles[i];
+    strncpy (tc.name, name, sizeof(tc.name)-1);
+    tc.name[sizeof(tc.name)-1] = '\0';
+    if (t1 && t2) {
+        strncpy (tc.t1, t1, sizeof(tc.t1)-1);
+        tc.t1[sizeof(tc.t1)-1] = '\0';
+        strncpy (tc.t2, t2, sizeof(tc.t2)-1);
+        tc.t2[sizeof(tc.t2)-1] = '\0';
+        tc.epoch = tleEpoch (tc.t1);
+    }
+    tc.fetched = now();
+
+    saveTLECache();
+}
+
+/* read the full list of TLEs from the backend unless not modified since last time.
+ * return whether ok.
+ */
+static bool fetchAllTLEs()
+{
+    WiFiClient all_client;
+    int status = 0;
+    int n_new = 0;
+    bool ok = false;
+
+    Serial.println (F("TLECache: reading all TLEs"));
+    resetWatchdog();
+    if (!wifiOk() || !all_client.connect (svr_host, HTTPPORT)) {
+        Serial.println (F("TLECache: network error"));
+        return (false);
+    }
+
+    TLECache *new_tles = (TLECache *) malloc (TLEC_MAX * sizeof(TLECache));
+    if (!new_tles)
+        goto out;
+
+    httpGETIMS (all_client, svr_host, sat_get_all, n_tles > 0 ? all_fetched : 0);
+    if (!httpSkipHeader (all_client, &status)) {
+        Serial.println (F("TLECache: bad header"));
+        goto out;
+    }
+
+    // not modified means all are still current
+    if (status == 304 && n_tles > 0) {
+        Serial.println (F("TLECache: all TLEs unchanged"));
+        all_fetched = now();
+        for (int i = 0; i < n_tles; i++)
+            tles[i].fetched = all_fetched;
+        ok = true;
+        goto out;
+    }
+
+    // read name and 2 lines until eof
+    while (n_new < TLEC_MAX) {
+        TLECache &tc = new_tles[n_new];
+        if (!getTCPLine (all_client, tc.name, sizeof(tc.name), NULL)
+                            || !getTCPLine (all_client, tc.t1, sizeof(tc.t1), NULL)
+                            || !getTCPLine (all_client, tc.t2, sizeof(tc.t2), NULL))
+            break;
+        if (!tleHasValidChecksum (tc.t1) || !tleHasValidChecksum (tc.t2)) {
+            Serial.printf ("TLECache: bad checksum for %s\n", tc.name);
+            continue;
+        }
+        tc.epoch = tleEpoch (tc.t1);
+        tc.fetched = now();
+        n_new++;
+    }
+
+    // replace the whole store
+    if (n_new > 0) {
+        Serial.printf ("TLECache: %d TLEs\n", n_new);
+        free (tles);
+        tles = new_tles;
+        new_tles = NULL;
+        n_tles = n_new;
+        all_fetched = now();
+        ok = true;
+    }
+
+out:
+
+    all_client.stop();
+    free (new_tles);
+
+    if (ok)
+        saveTLECache();
+
+    return (ok);
+}
+
+/* freshen the full list if it is older than TLE_REFRESH.
+ * return whether the store has any TLEs, even if they could not be freshened.
+ * N.B. caller must still check each epoch.
+ */
+bool freshenTLECache()
+{
+    loadTLECache();
+
+    time_t utc = now();
+    if (clockTimeOk() && utc - all_fetched >= TLE_REFRESH && utc >= all_retry) {
+        if (!fetchAllTLEs())
+            all_retry = utc + TLEC_RETRY;
+    }
+
+    return (n_tles > 0);
+}
+
+/* copy the name and elements of the ith stored TLE, in the order of the full list.
+ * return false if i is beyond the end.
+ */
+bool getCachedTLEn (int i, char name[NV_SATNAME_LEN], char t1[TLE_LINEL], char t2[TLE_LINEL])
+{
+    loadTLECache();
+
+    if (i < 0 || i >= n_tles)
+        return (false);
+
+    TLECache &tc = tles[i];
+    memcpy (name, tc.name, NV_SATNAME_LEN);
+    memcpy (t1, tc.t1, TLE_LINEL);
+    memcpy (t2, tc.t2, TLE_LINEL);
+    return (true);
+}
+
+/* return when the full list was last fetched or confirmed, 0 if never.
+ */
+time_t cachedTLEsFetched()
+{
+    loadTLECache();
+
+    return (all_fetched);
+}
+
+#else // !_USE_DESKTOP
+
+bool getCachedTLE (const char *name, char stored_name[NV_SATNAME_LEN], char t1[TLE_LINEL], char t2[TLE_LINEL],
+    time_t *fetched, time_t *epoch)
+{
+    (void) name;
+    (void) stored_name;
+    (void) t1;
+    (void) t2;
+    (void) fetched;
+    (void) epoch;
+    return (false);
+}
+
+void putCachedTLE (const char *name, const char *t1, const char *t2)
+{
+    (void) name;
+    (void) t1;
+    (void) t2;
+}
+
+bool freshenTLECache()
+{
+    return (false);
+}
+
+bool getCachedTLEn (int i, char name[NV_SATNAME_LEN], char t1[TLE_LINEL], char t2[TLE_LINEL])
+{
+    (void) i;
+    (void) name;
+    (void) t1;
+    (void) t2;
+    return (false);
+}
+
+time_t cachedTLEsFetched()
+{
+    return (0);
+}
+
+#endif // _USE_DESKTOP
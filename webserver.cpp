@@ -269,6 +269,64 @@ static bool sendWiFiSatellite (WiFiClient &client, char *not_used)
         FWIFIPRLN (client, F(" degs"));
     }
 
+    float mel, maz, mhrs;
+    if (getSatMaxEl (&mel, &maz, &mhrs)) {
+        FWIFIPR (client, F("Max alt "));
+        client.print (mel, 2);
+        FWIFIPR (client, F(" degs in "));
+        client.print (mhrs*60);
+        FWIFIPR (client, F(" mins at "));
+        client.print (maz, 2);
+        FWIFIPRLN (client, F(" degs"));
+    }
+
+    return (true);
+}
+
+/* send the upcoming passes of all catalog satellites, by rise time.
+ */
+static bool sendWiFiSatPasses (WiFiClient &client, char *not_used)
+{
+    (void) not_used;
+
+    // start reply
+    startPlainText (client);
+
+    // get timeline
+    #define MAX_WIFI_PASSES 100
+    SatCatPass *pp = (SatCatPass *) malloc (MAX_WIFI_PASSES * sizeof(SatCatPass));
+    int n = pp ? getSatCatPasses (pp, MAX_WIFI_PASSES) : 0;
+    if (n == 0) {
+        FWIFIPRLN (client, F("No passes"));
+        free (pp);
+        return (false);
+    }
+
+    // one line each
+    char line[120];
+    snprintf (line, sizeof(line), "# %d satellites\n#Name      Rise                RiseAz  MaxEl  Set                  SetAz",
+                nSatCat());
+    client.println (line);
+    for (int i = 0; i < n; i++) {
+        SatCatPass &p = pp[i];
+        char raz[10], saz[10];
+        if (p.rise_az == SAT_NOAZ)
+            strcpy (raz, "-");
+        else
+            snprintf (raz, sizeof(raz), "%.0f", p.rise_az);
+        if (p.set_az == SAT_NOAZ)
+            strcpy (saz, "-");
+        else
+            snprintf (saz, sizeof(saz), "%.0f", p.set_az);
+        snprintf (line, sizeof(line), "%-9s %04d-%02d-%02dT%02d:%02d:%02d %6s %6.1f  %04d-%02d-%02dT%02d:%02d:%02d %6s",
+                p.name,
+                year(p.rise), month(p.rise), day(p.rise), hour(p.rise), minute(p.rise), second(p.rise), raz,
+                p.max_el,
+                year(p.set), month(p.set), day(p.set), hour(p.set), minute(p.set), second(p.set), saz);
+        client.println (line);
+    }
+
+    free (pp);
     return (true);
 }
 
@@ -333,6 +391,58 @@ static bool sendWiFiStats (WiFiClient &client, char *not_used)
     return (true);
 }
 
+/* send map sweep timing
+ */
+static bool sendWiFiPerf (WiFiClient &client, char *not_used)
+{
+    (void) not_used;
+
+    // send html header
+    startPlainText(client);
+
+    // collect
+    MapPerfStat stats[MP_N];
+    getMapPerf (stats);
+
+    // send one line per phase, same order as MapPerfPhase
+    static const char *names[MP_N] = {
+        "Sweep", "Circumstances", "Render", "Symbols", "Stage", "Present"
+    };
+    char buf[100];
+    snprintf (buf, sizeof(buf), "%-14s %6s %10s %10s %10s", "Phase_us", "N", "p50", "p90", "Max");
+    client.println (buf);
+    for (int p = 0; p < MP_N; p++) {
+        resetWatchdog();
+        snprintf (buf, sizeof(buf), "%-14s %6lu %10lu %10lu %10lu", names[p], (unsigned long)stats[p].n,
+                (unsigned long)stats[p].p50, (unsigned long)stats[p].p90, (unsigned long)stats[p].max);
+        client.println (buf);
+    }
+    FWIFIPR (client, F("Logging   ")); client.println (log_map_perf ? "on" : "off");
+
+    return (true);
+}
+
+/* remote command to turn logging of each map sweep's timing on or off
+ */
+static bool setWiFiPerfLogOnOff (WiFiClient &client, char line[])
+{
+    // parse
+    if (strncmp (line, "on ", 3) == 0)
+        log_map_perf = 1;
+    else if (strncmp (line, "off ", 4) == 0)
+        log_map_perf = 0;
+    else
+        return (false);
+
+    // ack
+    startPlainText (client);
+    FWIFIPR (client, F("perfLog "));
+    client.println (log_map_perf ? "on" : "off");
+
+    // ok
+    return (true);
+}
+
 /* finish the wifi then reboot
  */
 static bool doWiFiReboot (WiFiClient &client, char *not_used)
@@ -804,7 +914,9 @@ static void serveRemote(WiFiClient &client)
         { PSTR("get_countdown "),     sendWiFiCountdown,     NULL },
         { PSTR("get_de "),            sendWiFiDEInfo,        NULL },
         { PSTR("get_dx "),            sendWiFiDXInfo,        NULL },
+        { PSTR("get_perf "),          sendWiFiPerf,          NULL },
         { PSTR("get_satellite "),     sendWiFiSatellite,     NULL },
+        { PSTR("get_satpasses "),     sendWiFiSatPasses,     NULL },
         { PSTR("get_sensors "),       sendWiFiSensorInfo,    NULL },
         { PSTR("get_stats "),         sendWiFiStats,         NULL },
         { PSTR("get_time "),          sendWiFiTime,          NULL },
@@ -818,6 +930,7 @@ static void serveRemote(WiFiClient &client)
         { PSTR("set_newdegrid?"),     setWiFiNewDEGrid,      PSTR("AB12") },
         { PSTR("set_newdx?"),         setWiFiNewDX,          PSTR("lat=X&lng=Y") },
         { PSTR("set_newdxgrid?"),     setWiFiNewDXGrid,      PSTR("AB12") },
+        { PSTR("set_perfLogOnOff?"),  setWiFiPerfLogOnOff,   PSTR("on|off") },
         { PSTR("set_satname?"),       setWiFiSatName,        PSTR("abc|none") },
         { PSTR("set_sattle?"),        setWiFiSatTLE,         PSTR("name=abc&t1=line1&t2=line2") },
         { PSTR("set_time?"),          setWiFiTime,           PSTR("ISO=YYYY-MM-DDTHH:MM:SS") },
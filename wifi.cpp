@@ -848,12 +848,28 @@ void sendUserAgent (WiFiClient &client)
 /* issue an HTTP Get
  */
 void httpGET (WiFiClient &client, const char *server, const char *page)
+{
+    httpGETIMS (client, server, page, 0);
+}
+
+/* issue an HTTP Get that asks for status 304 and no body if page has not changed since UNIX time ims.
+ * same as httpGET() if ims is 0.
+ */
+void httpGETIMS (WiFiClient &client, const char *server, const char *page, time_t ims)
 {
     resetWatchdog();
 
     FWIFIPR (client, F("GET ")); client.print(page); FWIFIPRLN (client, F(" HTTP/1.0"));
     FWIFIPR (client, F("Host: ")); client.println (server);
     sendUserAgent (client);
+    if (ims) {
+        // RFC 1123 date, N.B. day and month names share one static buffer
+        char date[40];
+        int l = snprintf (date, sizeof(date), "%s, %02d ", dayShortStr(weekday(ims)), day(ims));
+        snprintf (date+l, sizeof(date)-l, "%s %04d %02d:%02d:%02d GMT", monthShortStr(month(ims)),
+                                year(ims), hour(ims), minute(ims), second(ims));
+        FWIFIPR (client, F("If-Modified-Since: ")); client.println (date);
+    }
     FWIFIPRLN (client, F("Connection: close\r\n"));
 
     resetWatchdog();
@@ -874,6 +890,20 @@ bool httpSkipHeader (WiFiClient &client)
     return (true);
 }
 
+/* same as httpSkipHeader() but also return the HTTP status code, or 0 if none.
+ */
+bool httpSkipHeader (WiFiClient &client, int *status)
+{
+    char line[512];
+
+    if (!getTCPLine (client, line, sizeof(line), NULL))
+        return (false);
+    if (sscanf (line, "HTTP/%*s %d", status) != 1)
+        *status = 0;
+
+    return (line[0] == '\0' || httpSkipHeader (client));
+}
+
 /* retrieve and plot latest and predicted kp indices, return whether all ok
  */
 static bool updateKp(SBox &b)
@@ -1237,6 +1267,9 @@ static bool updateSDO ()
     // assume bad unless proven otherwise
     bool ok = false;
 
+    // malloced row of image pixels
+    uint16_t *row_pix = NULL;
+
     Serial.println(sdo_fn);
     resetWatchdog();
     if (wifiOk() && sdo_client.connect(svr_host, HTTPPORT)) {
@@ -1374,6 +1407,14 @@ static bool updateSDO ()
 	uint16_t xborder = img_w > v_b.w ? (img_w - v_b.w)/2 : 0;
 	uint16_t yborder = img_h > v_b.h ? (img_h - v_b.h)/2 : 0;
 
+	// collect each row's visible pixels here so they can be drawn as one batch
+	uint16_t row_w = img_w - xborder > v_b.w ? v_b.w : img_w - xborder;
+	row_pix = (uint16_t *) malloc (row_w * sizeof(uint16_t));
+	if (!row_pix) {
+	    Serial.println (F("SDO row malloc failed"));
+	    goto out;
+	}
+
 	// scan all pixels
 	for (uint16_t img_y = 0; img_y < img_h; img_y++) {
 
@@ -1391,22 +1432,27 @@ static bool updateSDO ()
 		    goto out;
 		}
 
-		// draw if fits
-		if (img_x >= xborder && img_x < xborder + v_b.w 
-			    && img_y >= yborder && img_y < yborder + v_b.h) {
-
+		// save if fits
+		if (img_x >= xborder && img_x < xborder + row_w) {
 		    uint8_t ur = r;
 		    uint8_t ug = g;
 		    uint8_t ub = b;
-		    uint16_t color16 = RGB565(ur,ug,ub);
+		    row_pix[img_x - xborder] = RGB565(ur,ug,ub);
+		}
+	    }
+
+	    // draw row if fits
+	    if (img_y >= yborder && img_y < yborder + v_b.h) {
+		uint16_t y = v_b.y + v_b.h - (img_y - yborder) - 1;            // vertical flip
+		tft.beginBatch();
+		for (uint16_t x = 0; x < row_w; x++) {
 #if defined(_USE_DESKTOP)
-		    tft.drawSubPixel (v_b.x + img_x - xborder,
-		    		v_b.y + v_b.h - (img_y - yborder) - 1, color16); // vertical flip
+		    tft.drawSubPixel (v_b.x + x, y, row_pix[x]);
 #else
-		    tft.drawPixel (v_b.x + img_x - xborder,
-		    		v_b.y + v_b.h - (img_y - yborder) - 1, color16); // vertical flip
+		    tft.drawPixel (v_b.x + x, y, row_pix[x]);
 #endif
 		}
+		tft.endBatch();
 	    }
 
 	    // skip padding to bring total row length to multiple of 4
@@ -1432,6 +1478,7 @@ static bool updateSDO ()
 out:
     if (!ok)
 	plotMessage (plot3_b, SDO_COLOR, "SDO failed");
+    free (row_pix);
     sdo_client.stop();
     printFreeHeap(F("SDO"));
     return (ok);